@@ -1,4 +1,5 @@
 #include <Frame.h>
+#include <FrameLoop.h>
 #include <LCDMap.h>
 #include <Queue.h>
 #include <LiquidCrystal.h>
@@ -13,6 +14,11 @@ const int cellsCount = 32;                  // total number of cell slots on the
 const int maxCustomChars = 8;               // maximum number of customer characters (due to memory)
 bool cells[cellsCount];                     // keeps track of which cells are filled with custom character
 
+// moves the balls every 100 ms and redraws whenever there is time left
+void moveBalls(LCDMap& map);
+void draw(LCDMap& map);
+FrameLoop frameLoop(control, 100000UL, moveBalls, draw);
+
 void setup() {
   for (int i = 0; i < cellsCount; ++i) {
     cells[i] = false;
@@ -30,18 +36,21 @@ void setup() {
 }
 
 void loop() {
+  frameLoop.tick();
+}
+
+// --------------------------------- description -----------------------------------
+// moves every ball forward, bouncing off the boundaries
+// ---------------------------------------------------------------------------------
+void moveBalls(LCDMap& map) {
   char id = 'A';
   for (int i = 0; i < 8; ++i) {
     // if ball reaches the edge, they will bound off
     bounceOffBounds((char) (id + i), false);
 
     // move ball forward by two pixels
-    control.shiftSpriteForward((char) (id + i), 2);
+    map.shiftSpriteForward((char) (id + i), 2);
   }
-
-  draw();
-  
-  delay(100);
 }
 
 // --------------------------------- description -----------------------------------
@@ -64,7 +73,7 @@ void bounceOffBounds(char id, bool randomize) {
 // --------------------------------- description -----------------------------------
 // reads all custom characters and draws them on the lcd
 // ---------------------------------------------------------------------------------
-void draw() {
+void draw(LCDMap& map) {
   // can only go up to a maximum of 8
   short customCharCount = 0;
 
@@ -73,7 +82,7 @@ void draw() {
     short col = (short) i % 16;
 
     // get the bytes for a custom character at the current cell
-    unsigned char* result = control.readCharacter(row, col);
+    unsigned char* result = map.readCharacter(row, col);
 
     // erase current cell if a character will not be drawn again
     if (result == nullptr || customCharCount >= maxCustomChars) {
@@ -1,4 +1,5 @@
 #include <Frame.h>
+#include <FrameLoop.h>
 #include <LCDMap.h>
 #include <Queue.h>
 #include <LiquidCrystal.h>
@@ -17,6 +18,11 @@ const char clockBase = 'B';
 const char minuteHand = 'M';
 const char hourHand = 'H';
 
+// turns the hands every 75 ms and redraws whenever there is time left
+void turnHands(LCDMap& map);
+void draw(LCDMap& map);
+FrameLoop frameLoop(control, 75000UL, turnHands, draw);
+
 void setup() {
   for (int i = 0; i < cellsCount; ++i) {
     cells[i] = false;
@@ -26,30 +32,33 @@ void setup() {
   createMinuteHand(minuteHand);
   createHourHand(hourHand);
 
+  // hands move with the clock base
+  control.setParent(minuteHand, clockBase);
+  control.setParent(hourHand, clockBase);
   control.shiftSprite(clockBase, 12, -3);
-  control.shiftSprite(minuteHand, 12, -3);
-  control.shiftSprite(hourHand, 12, -3);
-  
 
   // initialize LCD display
   lcd.begin(2, 16);
 }
 
 void loop() {
-  control.rotateSprite(minuteHand, 45);
-  if (control.getSpriteRot(minuteHand) == 0) {
-    control.rotateSprite(hourHand, 45);
-  }
+  frameLoop.tick();
+}
 
-  draw();
-  
-  delay(75);
+// --------------------------------- description -----------------------------------
+// turns the minute hand, and the hour hand once every full turn of the minute hand
+// ---------------------------------------------------------------------------------
+void turnHands(LCDMap& map) {
+  map.rotateSprite(minuteHand, 45);
+  if (map.getSpriteRot(minuteHand) == 0) {
+    map.rotateSprite(hourHand, 45);
+  }
 }
 
 // --------------------------------- description -----------------------------------
 // reads all custom characters and draws them on the lcd
 // ---------------------------------------------------------------------------------
-void draw() {
+void draw(LCDMap& map) {
   // can only go up to a maximum of 8
   short customCharCount = 0;
 
@@ -58,7 +67,7 @@ void draw() {
     short col = (short) i % 16;
 
     // get the bytes for a custom character at the current cell
-    unsigned char* result = control.readCharacter(row, col);
+    unsigned char* result = map.readCharacter(row, col);
 
     // erase current cell if a character will not be drawn again
     if (result == nullptr || customCharCount >= maxCustomChars) {
@@ -92,29 +101,13 @@ void createClockBase(char clockBase) {
 void createMinuteHand(char minuteHand) {
   control.createSprite(minuteHand, 15);
   control.addFrame(minuteHand, 'A');
-  control.drawFrameH(minuteHand, 'A', 7, 7);
-  control.drawFrameH(minuteHand, 'A', 7, 6);
-  control.drawFrameH(minuteHand, 'A', 7, 5);
-  control.drawFrameH(minuteHand, 'A', 7, 4);
-  control.drawFrameH(minuteHand, 'A', 7, 3);
-  control.drawFrameH(minuteHand, 'A', 7, 2);
-  
-  control.drawFrameD(minuteHand, 'A', 7, 7);
-  control.drawFrameD(minuteHand, 'A', 8, 6);
-  control.drawFrameD(minuteHand, 'A', 9, 5);
-  control.drawFrameD(minuteHand, 'A', 10, 4);
-  control.drawFrameD(minuteHand, 'A', 11, 3);
+  control.getFrameH(minuteHand, 'A')->drawLine(7, 7, 7, 2);
+  control.getFrameD(minuteHand, 'A')->drawLine(7, 7, 11, 3);
 }
 
 void createHourHand(char hourHand) {
   control.createSprite(hourHand, 15);
   control.addFrame(hourHand, 'A');
-  control.drawFrameH(hourHand, 'A', 7, 7);
-  control.drawFrameH(hourHand, 'A', 7, 6);
-  control.drawFrameH(hourHand, 'A', 7, 5);
-  control.drawFrameH(hourHand, 'A', 7, 4);
-  
-  control.drawFrameD(hourHand, 'A', 7, 7);
-  control.drawFrameD(hourHand, 'A', 8, 6);
-  control.drawFrameD(hourHand, 'A', 9, 5);
+  control.getFrameH(hourHand, 'A')->drawLine(7, 7, 7, 4);
+  control.getFrameD(hourHand, 'A')->drawLine(7, 7, 9, 5);
 }
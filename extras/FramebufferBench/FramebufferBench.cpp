@@ -0,0 +1,81 @@
+// Title: FramebufferBench
+// Created by: Vlad Netrebchenko
+// Start Date: July 13, 2019
+// Last Modification: July 13, 2019
+
+// Description:
+// Host benchmark for the graphical LCD backend. Fills a 128x64 and a
+// 240x64 screen with moving, rotating sprites, renders them into a
+// Framebuffer and flushes it to a MockController, timing both steps.
+//
+// Build (from the repository root):
+//   g++ -O2 -Isrc/LCDMap extras/FramebufferBench/FramebufferBench.cpp src/LCDMap/*.cpp -o framebuffer-bench
+//
+// Usage:
+//   framebuffer-bench [sprites] [frames]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "LCDMap.h"
+
+using namespace std;
+
+const short SPRITE_SIZE = 8;
+
+// runs given number of frames on a screen of given size and prints timings
+static void bench(short width, short height, int spriteCount, int frameCount) {
+	LCDMap map(width, height);
+	map.setBounds(0, 0, 0, 0);
+	srand(1);
+
+	for (int i = 0; i < spriteCount; ++i) {
+		char id = (char) (i + 1);
+		map.createSprite(id, SPRITE_SIZE);
+		map.addFrame(id, 'A');
+		for (short j = 0; j < SPRITE_SIZE; ++j) {
+			map.drawFrameH(id, 'A', SPRITE_SIZE / 2, j);
+			map.drawFrameH(id, 'A', j, SPRITE_SIZE - 1);
+			map.drawFrameD(id, 'A', j, SPRITE_SIZE - 1 - j);
+		}
+		map.shiftSprite(id, rand() % width, rand() % height);
+		map.rotateSprite(id, (rand() % 8) * 45);
+		map.setSpriteVelocity(id, 1);
+	}
+
+	Framebuffer framebuffer(width, height);
+	MockController controller(width, height);
+	double renderUs = 0;
+	double flushUs = 0;
+
+	for (int frame = 0; frame < frameCount; ++frame) {
+		map.stepAll(1);
+		map.rotateSprite((char) (frame % spriteCount + 1), 45);
+
+		auto start = chrono::steady_clock::now();
+		map.render(framebuffer);
+		auto rendered = chrono::steady_clock::now();
+		framebuffer.flush(controller);
+		auto flushed = chrono::steady_clock::now();
+
+		renderUs += chrono::duration<double, micro>(rendered - start).count();
+		flushUs += chrono::duration<double, micro>(flushed - rendered).count();
+	}
+
+	int pageSegments = framebuffer.pages() * framebuffer.segments();
+	printf("%dx%d, %d sprites: render %.1f us, flush %.1f us, %.1f of %d pages sent per frame\n",
+		width, height, spriteCount, renderUs / frameCount, flushUs / frameCount,
+		(double) controller.pagesWritten() / frameCount, pageSegments);
+}
+
+int main(int argc, char** argv) {
+	int spriteCount = (argc > 1) ? atoi(argv[1]) : 64;
+	int frameCount = (argc > 2) ? atoi(argv[2]) : 1000;
+	spriteCount = (spriteCount < 1) ? 1 : (spriteCount > 120) ? 120 : spriteCount;
+	frameCount = (frameCount < 1) ? 1 : frameCount;
+
+	bench(128, 64, spriteCount, frameCount);
+	bench(240, 64, spriteCount, frameCount);
+	return 0;
+}
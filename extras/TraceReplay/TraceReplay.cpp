@@ -0,0 +1,217 @@
+// Title: TraceReplay
+// Created by: Vlad Netrebchenko
+// Start Date: July 10, 2019
+// Last Modification: July 10, 2019
+
+// Description:
+// Host tool that replays a trace recorded by TraceRecorder.
+// Every recorded change is applied to a fresh LCDMap, and on every
+// tick all characters are rendered again, timed, and compared
+// against the characters recorded on the device.
+//
+// Build (from the repository root):
+//   g++ -O2 -Isrc/LCDMap extras/TraceReplay/TraceReplay.cpp src/LCDMap/*.cpp -o trace-replay
+//
+// Usage:
+//   trace-replay <trace file> [-q]
+//   -q prints only the summary instead of one line per frame
+// Exits with 1 if any rendered character differs from the recording,
+// or if the trace is truncated. Frames read from a FrameStream are not
+// in the trace, so while a sprite is streamed, differing frames are
+// reported as not comparable instead.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "LCDMap.h"
+#include "Trace.h"
+
+using namespace std;
+
+// ids of sprites that play frames from a stream, which replay cannot reproduce
+static bool streamed[256];
+static int streamedCount = 0;
+
+// marks sprite as streamed or not, warning the first time it is streamed
+static void setStreamed(int id, bool value) {
+	unsigned char index = id;
+	if (streamed[index] == value) return;
+
+	if (value) {
+		fprintf(stderr, "sprite '%c' plays frames from a stream, which the trace does not contain\n", index);
+	}
+	streamed[index] = value;
+	streamedCount += value ? 1 : -1;
+}
+
+// applies recorded change to map
+static void apply(LCDMap& map, unsigned char op, const int* args) {
+	switch (op) {
+		case TRACE_CREATE:
+			map.createSprite(args[0], args[1]);
+			break;
+		case TRACE_REMOVE:
+			map.removeSprite(args[0]);
+			setStreamed(args[0], false);
+			break;
+		case TRACE_ADD_FRAME:
+			map.addFrame(args[0], args[1]);
+			break;
+		case TRACE_DRAW_H:
+			map.drawFrameH(args[0], args[1], args[2], args[3]);
+			break;
+		case TRACE_DRAW_D:
+			map.drawFrameD(args[0], args[1], args[2], args[3]);
+			break;
+		case TRACE_ERASE_H:
+			map.eraseFrameH(args[0], args[1], args[2], args[3]);
+			break;
+		case TRACE_ERASE_D:
+			map.eraseFrameD(args[0], args[1], args[2], args[3]);
+			break;
+		case TRACE_NEXT_FRAME:
+			map.nextFrame(args[0]);
+			break;
+		case TRACE_SHIFT:
+			map.shiftSprite(args[0], args[1], args[2]);
+			break;
+		case TRACE_SHIFT_FORWARD:
+			map.shiftSpriteForward(args[0], args[1]);
+			break;
+		case TRACE_ROTATE:
+			map.rotateSprite(args[0], args[1]);
+			break;
+		case TRACE_SET_VELOCITY:
+			map.setSpriteVelocity(args[0], args[1]);
+			break;
+		case TRACE_STEP_ALL:
+			map.stepAll(args[0]);
+			break;
+		case TRACE_SET_BOUNDS:
+			map.setBounds(args[0], args[1], args[2], args[3]);
+			break;
+		case TRACE_REMOVE_BOUNDS:
+			map.removeBounds();
+			break;
+		case TRACE_SET_PARENT:
+			map.setParent(args[0], args[1]);
+			break;
+		case TRACE_REMOVE_PARENT:
+			map.removeParent(args[0]);
+			break;
+		case TRACE_NEXT_FRAME_GROUP:
+			map.nextFrameGroup(args[0]);
+			break;
+		case TRACE_ATTACH_STREAM:
+			setStreamed(args[0], map.contains(args[0]) && args[1] != 0);
+			break;
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <trace file> [-q]\n", argv[0]);
+		return 2;
+	}
+	bool quiet = argc > 2 && strcmp(argv[2], "-q") == 0;
+
+	// read whole trace into memory
+	FILE* file = fopen(argv[1], "rb");
+	if (file == nullptr) {
+		fprintf(stderr, "cannot open %s\n", argv[1]);
+		return 2;
+	}
+	vector<unsigned char> data;
+	unsigned char chunk[4096];
+	size_t count;
+	while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+		data.insert(data.end(), chunk, chunk + count);
+	}
+	fclose(file);
+
+	TraceReader reader(data.data(), data.size());
+	short rows, cols, charWidth, charHeight;
+	if (!reader.readHeader(rows, cols, charWidth, charHeight)) {
+		fprintf(stderr, "%s is not a trace\n", argv[1]);
+		return 2;
+	}
+
+	LCDMap map(charWidth, charHeight);
+	int cells = rows * cols;
+	vector<unsigned char> recorded(cells * charHeight, 0);
+	vector<unsigned char> delta(charHeight);
+
+	unsigned char op;
+	int args[TRACE_MAX_ARGS];
+	long frames = 0;
+	long badFrames = 0;
+	long unknownFrames = 0;
+	double totalUs = 0;
+	double maxUs = 0;
+
+	while (reader.next(op, args)) {
+		// frame changed on the device through getFrameH() or getFrameD()
+		if (op == TRACE_FRAME_BYTES) {
+			vector<unsigned char> bytes(args[3] > 0 ? args[3] : 0);
+			if (!reader.readBytes(bytes.data(), bytes.size())) break;
+
+			Frame* frame = args[2] ? map.getFrameD(args[0], args[1]) : map.getFrameH(args[0], args[1]);
+			if (frame != nullptr) {
+				frame->writeBytes(0, bytes.data(), bytes.size());
+			}
+			continue;
+		}
+
+		if (op != TRACE_TICK) {
+			apply(map, op, args);
+			continue;
+		}
+
+		// rebuild recorded characters from the tick's deltas
+		int cell;
+		while (reader.nextCell(cell, delta.data())) {
+			if (cell >= cells) continue;
+			for (int i = 0; i < charHeight; ++i) {
+				recorded[cell * charHeight + i] ^= delta[i];
+			}
+		}
+
+		// render every cell and compare against the recording
+		int mismatches = 0;
+		auto start = chrono::steady_clock::now();
+		for (int i = 0; i < cells; ++i) {
+			unsigned char* character = map.readCharacter(i / cols, i % cols);
+			for (int j = 0; j < charHeight; ++j) {
+				unsigned char value = (character == nullptr) ? 0 : character[j];
+				if (value != recorded[i * charHeight + j]) {
+					mismatches++;
+					break;
+				}
+			}
+			delete[] character;
+		}
+		double us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+
+		totalUs += us;
+		maxUs = (us > maxUs) ? us : maxUs;
+		bool comparable = streamedCount == 0;
+		badFrames += (mismatches > 0 && comparable) ? 1 : 0;
+		unknownFrames += (mismatches > 0 && !comparable) ? 1 : 0;
+		if (!quiet || mismatches > 0) {
+			printf("frame %ld: %.1f us, %d mismatched cells%s\n", frames, us, mismatches,
+				(mismatches > 0 && !comparable) ? " (streamed sprite, not comparable)" : "");
+		}
+		frames++;
+	}
+
+	if (!reader.valid()) {
+		fprintf(stderr, "trace truncated or corrupt at byte %ld\n", reader.position());
+	}
+
+	printf("%ld frames, avg %.1f us, max %.1f us, %ld frames differ, %ld not comparable\n",
+		frames, frames > 0 ? totalUs / frames : 0.0, maxUs, badFrames, unknownFrames);
+
+	return (badFrames > 0 || !reader.valid()) ? 1 : 0;
+}
@@ -7,14 +7,21 @@
 // Frame stores a user-generated image as a series of bytes.
 // The user is able to change the state of individual pixels on
 // the image, which are either on or off. The user can also
-// retrieve rows and columns from the image.
+// retrieve rows and columns from the image, draw shapes, and
+// turn one image into another.
 
 #include "Frame.h"
 
+// shear factors (out of 256) that turn an image 45 degrees clockwise:
+// rows by -tan(22.5), columns by sin(45), rows by -tan(22.5) again
+const short SHEAR_ROWS = -106;
+const short SHEAR_COLS = 181;
+
 // initializes image to given height and width, or a default size of 1 x 1
 // if height or width are too small
 Frame::Frame(short sideLength) {
 	length = (sideLength < 1) ? 1 : sideLength;
+	changes = 0;
 	
 	// initialize byte array
 	bytes = toIndex(length - 1, length - 1) + 1;
@@ -43,7 +50,8 @@ void Frame::clear() {
 	// set all bytes to 0
 	for (int i = 0; i < bytes; i++) {
 		pixels[i] = 0;
-	}	
+	}
+	changes++;
 }
 
 // returns side length of image
@@ -51,6 +59,44 @@ short Frame::size() const {
 	return length;
 }
 
+// returns number that changes every time the image is changed
+unsigned int Frame::version() const {
+	return changes;
+}
+
+// returns number of bytes used to store the image
+int Frame::byteSize() const {
+	return bytes;
+}
+
+// copies given bytes into the image, starting at given byte offset
+// bytes are in the same row-wrapped order as the image is stored
+// returns number of bytes copied
+int Frame::writeBytes(int offset, const unsigned char* data, int count) {
+	if (offset < 0 || data == nullptr) return 0;
+
+	int copied = 0;
+	for (int i = offset; i < bytes && copied < count; ++i) {
+		pixels[i] = data[copied++];
+	}
+	changes++;
+
+	return copied;
+}
+
+// copies bytes of the image into given array, starting at given byte offset
+// returns number of bytes copied
+int Frame::readBytes(int offset, unsigned char* data, int count) const {
+	if (offset < 0 || data == nullptr) return 0;
+
+	int copied = 0;
+	for (int i = offset; i < bytes && copied < count; ++i) {
+		data[copied++] = pixels[i];
+	}
+
+	return copied;
+}
+
 // reads requested row into given byte array
 // returns size of resulting byte array
 // returns 0 and sets array to nullptr if row out of bounds
@@ -65,6 +111,346 @@ int Frame::getCol(short col, unsigned char*& arr) const {
 	return readLine(false, col, arr);
 }
 
+// returns count pixels (up to 64) of given row, starting at pixel first
+// first pixel is the most significant bit, pixels past the edge read as 0
+unsigned long long Frame::getRowBits(short row, short first, short count) const {
+	if (!validPixel(first, row) || count < 1) return 0;
+	if (count > 64) count = 64;
+	if (count > length - first) count = length - first;
+
+	// row pixels are consecutive bits, so load the 9 bytes they can span
+	int start = toPixel(first, row);
+	int index = start / 8;
+	short skip = start % 8;
+
+	unsigned long long bits = 0;
+	for (int i = 0; i < 8; ++i) {
+		bits = (bits << 8) | ((index + i < bytes) ? pixels[index + i] : 0);
+	}
+	if (skip > 0) {
+		bits <<= skip;
+		bits |= (index + 8 < bytes) ? pixels[index + 8] >> (8 - skip) : 0;
+	}
+
+	return (count == 64) ? bits : bits & ~(~0ULL >> count);
+}
+
+// returns count pixels (up to 64) of given column, starting at pixel first
+// first pixel is the most significant bit, pixels past the edge read as 0
+unsigned long long Frame::getColBits(short col, short first, short count) const {
+	if (!validPixel(col, first) || count < 1) return 0;
+	if (count > 64) count = 64;
+	if (count > length - first) count = length - first;
+
+	unsigned long long bits = 0;
+	int pixel = toPixel(col, first);
+	for (int i = 0; i < count; ++i) {
+		bits |= (unsigned long long) ((pixels[pixel / 8] >> (7 - pixel % 8)) & 1) << (63 - i);
+		pixel += length;
+	}
+
+	return bits;
+}
+
+// reverses the order of the top count bits, keeping them at the top
+unsigned long long Frame::reverseBits(unsigned long long bits, short count) {
+	bits = ((bits >> 1) & 0x5555555555555555ULL) | ((bits & 0x5555555555555555ULL) << 1);
+	bits = ((bits >> 2) & 0x3333333333333333ULL) | ((bits & 0x3333333333333333ULL) << 2);
+	bits = ((bits >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((bits & 0x0F0F0F0F0F0F0F0FULL) << 4);
+	bits = ((bits >> 8) & 0x00FF00FF00FF00FFULL) | ((bits & 0x00FF00FF00FF00FFULL) << 8);
+	bits = ((bits >> 16) & 0x0000FFFF0000FFFFULL) | ((bits & 0x0000FFFF0000FFFFULL) << 16);
+	bits = (bits >> 32) | (bits << 32);
+
+	return (count >= 64) ? bits : bits << (64 - count);
+}
+
+// sets pixels x0 to x1 (inclusive) of given row to given value
+// pixels outside the image are skipped
+void Frame::drawSpan(short x0, short x1, short y, bool value) {
+	if (x0 > x1) {
+		short temp = x0;
+		x0 = x1;
+		x1 = temp;
+	}
+	if (y < 0 || y >= length || x1 < 0 || x0 >= length) return;
+
+	x0 = (x0 < 0) ? 0 : x0;
+	x1 = (x1 >= length) ? length - 1 : x1;
+	fillBits(toPixel(x0, y), toPixel(x1, y), value);
+}
+
+// sets pixels on the line from (x0, y0) to (x1, y1) to given value (Bresenham)
+// pixels outside the image are skipped
+void Frame::drawLine(short x0, short y0, short x1, short y1, bool value) {
+	if (y0 == y1) {
+		drawSpan(x0, x1, y0, value);
+		return;
+	}
+
+	int dx = (x1 > x0) ? x1 - x0 : x0 - x1;
+	int dy = (y1 > y0) ? y0 - y1 : y1 - y0;
+	short stepX = (x0 < x1) ? 1 : -1;
+	short stepY = (y0 < y1) ? 1 : -1;
+	int error = dx + dy;
+
+	while (true) {
+		setPixel(x0, y0, value);
+		if (x0 == x1 && y0 == y1) break;
+
+		int error2 = error * 2;
+		if (error2 >= dy) {
+			error += dy;
+			x0 += stepX;
+		}
+		if (error2 <= dx) {
+			error += dx;
+			y0 += stepY;
+		}
+	}
+}
+
+// sets outline of rectangle with top left corner at (x, y) to given value
+void Frame::drawRect(short x, short y, short width, short height, bool value) {
+	if (width < 1 || height < 1) return;
+
+	short right = x + width - 1;
+	short bottom = y + height - 1;
+	drawSpan(x, right, y, value);
+	drawSpan(x, right, bottom, value);
+	for (short row = y + 1; row < bottom; ++row) {
+		setPixel(x, row, value);
+		setPixel(right, row, value);
+	}
+}
+
+// sets every pixel of rectangle with top left corner at (x, y) to given value
+void Frame::fillRect(short x, short y, short width, short height, bool value) {
+	if (width < 1 || height < 1) return;
+
+	short top = (y < 0) ? 0 : y;
+	short bottom = (y + height > length) ? length - 1 : y + height - 1;
+	if (top > bottom) return;
+
+	// full rows are stored back to back, so they can be filled as one span
+	if (x <= 0 && x + width >= length) {
+		fillBits(toPixel(0, top), toPixel(length - 1, bottom), value);
+		return;
+	}
+
+	for (short row = top; row <= bottom; ++row) {
+		drawSpan(x, x + width - 1, row, value);
+	}
+}
+
+// sets outline of circle with given center and radius to given value (midpoint)
+void Frame::drawCircle(short cx, short cy, short radius, bool value) {
+	if (radius < 0) return;
+
+	short x = radius;
+	short y = 0;
+	int error = 1 - radius;
+
+	while (x >= y) {
+		setPixel(cx + x, cy + y, value);
+		setPixel(cx - x, cy + y, value);
+		setPixel(cx + x, cy - y, value);
+		setPixel(cx - x, cy - y, value);
+		setPixel(cx + y, cy + x, value);
+		setPixel(cx - y, cy + x, value);
+		setPixel(cx + y, cy - x, value);
+		setPixel(cx - y, cy - x, value);
+
+		y++;
+		if (error < 0) {
+			error += 2 * y + 1;
+		} else {
+			x--;
+			error += 2 * (y - x) + 1;
+		}
+	}
+}
+
+// sets every pixel of circle with given center and radius to given value
+void Frame::fillCircle(short cx, short cy, short radius, bool value) {
+	if (radius < 0) return;
+
+	short x = radius;
+	short y = 0;
+	int error = 1 - radius;
+
+	while (x >= y) {
+		drawSpan(cx - x, cx + x, cy + y, value);
+		drawSpan(cx - x, cx + x, cy - y, value);
+		drawSpan(cx - y, cx + y, cy + x, value);
+		drawSpan(cx - y, cx + y, cy - x, value);
+
+		y++;
+		if (error < 0) {
+			error += 2 * y + 1;
+		} else {
+			x--;
+			error += 2 * (y - x) + 1;
+		}
+	}
+}
+
+// draws every empty pixel connected (up, down, left or right) to the one at (x, y)
+// returns false if position is out of bounds or already drawn
+bool Frame::floodFill(short x, short y) {
+	if (!validPixel(x, y) || getPixel(x, y)) return false;
+
+	// stack of (x, y) pairs, one per run of empty pixels still to fill
+	int capacity = length;
+	int top = 0;
+	short* stack = new short[capacity * 2];
+	stack[top++] = x;
+	stack[top++] = y;
+
+	while (top > 0) {
+		short seedY = stack[--top];
+		short seedX = stack[--top];
+		if (getPixel(seedX, seedY)) continue;
+
+		// fill the whole run around the seed at once
+		short left = seedX;
+		short right = seedX;
+		while (left > 0 && !getPixel(left - 1, seedY)) left--;
+		while (right < length - 1 && !getPixel(right + 1, seedY)) right++;
+		fillBits(toPixel(left, seedY), toPixel(right, seedY), true);
+
+		// add one seed for every empty run above and below
+		for (short row = seedY - 1; row <= seedY + 1; row += 2) {
+			if (row < 0 || row >= length) continue;
+
+			bool inRun = false;
+			for (short col = left; col <= right; ++col) {
+				bool empty = !getPixel(col, row);
+				if (empty && !inRun) {
+					if (top == capacity * 2) {
+						short* temp = new short[capacity * 4];
+						for (int i = 0; i < top; ++i) {
+							temp[i] = stack[i];
+						}
+						delete[] stack;
+						stack = temp;
+						capacity *= 2;
+					}
+					stack[top++] = col;
+					stack[top++] = row;
+				}
+				inRun = empty;
+			}
+		}
+	}
+
+	delete[] stack;
+	return true;
+}
+
+// draws every lit pixel of src onto this frame, with src's top left corner at (x, y),
+// rotated clockwise by given degrees (multiple of 90); pixels outside the frame are skipped
+// returns false if rotation is not a multiple of 90
+bool Frame::blit(const Frame& src, short x, short y, short degrees) {
+	if (degrees % 90 != 0) return false;
+
+	short rotation = ((degrees % 360) + 360) % 360;
+	short size = src.size();
+
+	for (short row = 0; row < size; ++row) {
+		if (y + row < 0 || y + row >= length) continue;
+
+		for (short col = 0; col < size; col += 64) {
+			short count = (size - col > 64) ? 64 : size - col;
+			short reversedCol = size - col - count;
+			unsigned long long bits;
+			bool reversed;
+
+			// read the source row that ends up on this row after rotation
+			switch (rotation) {
+				case 0:
+					bits = src.getRowBits(row, col, count);
+					reversed = false;
+					break;
+				case 90:
+					bits = src.getColBits(row, reversedCol, count);
+					reversed = true;
+					break;
+				case 180:
+					bits = src.getRowBits(size - 1 - row, reversedCol, count);
+					reversed = true;
+					break;
+				default:
+					bits = src.getColBits(size - 1 - row, col, count);
+					reversed = false;
+					break;
+			}
+
+			orRowBits(x + col, y + row, reversed ? reverseBits(bits, count) : bits, count);
+		}
+	}
+
+	return true;
+}
+
+// replaces image with src turned 45 degrees clockwise around its center
+// done as three shears, so every pass moves whole rows or columns
+// pixels turned past the edges are lost
+// scratch holds the middle pass, so no frame is allocated
+// returns false if src or scratch is not the same size, or is this frame
+bool Frame::rotate45(const Frame& src, Frame& scratch) {
+	if (src.size() != length || scratch.size() != length) return false;
+	if (&src == this || &scratch == this || &scratch == &src) return false;
+
+	clear();
+	shearRows(src, SHEAR_ROWS);
+	scratch.clear();
+	scratch.shearCols(*this, SHEAR_COLS);
+
+	clear();
+	shearRows(scratch, SHEAR_ROWS);
+	return true;
+}
+
+// draws src with every row moved right by factor / 256 pixels per row below the center
+void Frame::shearRows(const Frame& src, short factor) {
+	for (short row = 0; row < length; ++row) {
+		short offset = shearOffset(factor, row);
+
+		for (short col = 0; col < length; col += 64) {
+			short count = (length - col > 64) ? 64 : length - col;
+			unsigned long long bits = src.getRowBits(row, col, count);
+
+			if (bits != 0) {
+				orRowBits(col + offset, row, bits, count);
+			}
+		}
+	}
+}
+
+// draws src with every column moved down by factor / 256 pixels per column right of the center
+void Frame::shearCols(const Frame& src, short factor) {
+	for (short col = 0; col < length; ++col) {
+		short offset = shearOffset(factor, col);
+
+		for (short row = 0; row < length; row += 64) {
+			short count = (length - row > 64) ? 64 : length - row;
+			unsigned long long bits = src.getColBits(col, row, count);
+
+			for (short i = 0; bits != 0; ++i, bits <<= 1) {
+				if (bits >> 63) {
+					setPixel(col, row + i + offset, true);
+				}
+			}
+		}
+	}
+}
+
+// returns distance (rounded) a line moves when sheared by factor / 256 around the center
+short Frame::shearOffset(short factor, short line) const {
+	long distance = (long) factor * (2 * line - (length - 1));
+	return (distance >= 0) ? (distance + 256) / 512 : -((256 - distance) / 512);
+}
+
 // reads bytes of requested row or column into given byte array
 // returns size of resulting byte array
 // returns 0 and sets array to nullptr if line out of bounds
@@ -110,6 +496,7 @@ bool Frame::setPixel(short x, short y, bool value) {
 	int offset = toOffset(x, y);
 
 	// set value at index + offset to 0 or 1
+	changes++;
 	if (value) {
 		pixels[index] |= 1 << offset; 
 	} else {
@@ -119,6 +506,61 @@ bool Frame::setPixel(short x, short y, bool value) {
 	return true;
 }
 
+// sets every pixel from cumulative index first to last (inclusive) to given value
+// whole bytes are written at once, with masks for the partial bytes at either end
+void Frame::fillBits(int first, int last, bool value) {
+	int firstByte = first / 8;
+	int lastByte = last / 8;
+	unsigned char headMask = 0xFF >> (first % 8);
+	unsigned char tailMask = 0xFF << (7 - last % 8);
+
+	if (firstByte == lastByte) {
+		headMask &= tailMask;
+	}
+	changes++;
+
+	pixels[firstByte] = value ? (pixels[firstByte] | headMask) : (pixels[firstByte] & ~headMask);
+	if (firstByte == lastByte) return;
+
+	for (int i = firstByte + 1; i < lastByte; ++i) {
+		pixels[i] = value ? 0xFF : 0x00;
+	}
+
+	pixels[lastByte] = value ? (pixels[lastByte] | tailMask) : (pixels[lastByte] & ~tailMask);
+}
+
+// draws count pixels (up to 64) starting at (x, y), the first being the
+// most significant bit of bits; pixels outside the row are skipped
+void Frame::orRowBits(short x, short y, unsigned long long bits, short count) {
+	if (y < 0 || y >= length || count < 1 || x >= length || x + count <= 0) return;
+
+	// cut off pixels left and right of the row
+	if (x < 0) {
+		bits <<= -x;
+		count += x;
+		x = 0;
+	}
+	if (x + count > length) {
+		count = length - x;
+	}
+	if (count < 64) {
+		bits &= ~(~0ULL >> count);
+	}
+
+	// or the bits in a byte at a time, aligned to the first pixel's byte
+	changes++;
+	int start = toPixel(x, y);
+	int index = start / 8;
+	short shift = start % 8;
+
+	pixels[index] |= bits >> (56 + shift);
+	bits <<= 8 - shift;
+	for (int i = index + 1; bits != 0 && i < bytes; ++i) {
+		pixels[i] |= bits >> 56;
+		bits <<= 8;
+	}
+}
+
 // returns false if position is out of bounds, true otherwise
 bool Frame::validPixel(short x, short y) const {
 	return y >= 0 && y < length && x >= 0 && x < length;
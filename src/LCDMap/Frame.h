@@ -13,13 +13,31 @@ public:
 	bool clearPixel(short x, short y);
 	void clear();
 	short size() const;
+	unsigned int version() const;
+	int byteSize() const;
+	int writeBytes(int offset, const unsigned char* data, int count);
+	int readBytes(int offset, unsigned char* data, int count) const;
 	int getRow(short row, unsigned char*& arr) const;
 	int getCol(short col, unsigned char*& arr) const;
+	unsigned long long getRowBits(short row, short first, short count) const;
+	unsigned long long getColBits(short col, short first, short count) const;
+	static unsigned long long reverseBits(unsigned long long bits, short count);
+
+	void drawSpan(short x0, short x1, short y, bool value = true);
+	void drawLine(short x0, short y0, short x1, short y1, bool value = true);
+	void drawRect(short x, short y, short width, short height, bool value = true);
+	void fillRect(short x, short y, short width, short height, bool value = true);
+	void drawCircle(short cx, short cy, short radius, bool value = true);
+	void fillCircle(short cx, short cy, short radius, bool value = true);
+	bool floodFill(short x, short y);
+	bool blit(const Frame& src, short x, short y, short degrees);
+	bool rotate45(const Frame& src, Frame& scratch);
 
 private:
 	short length;
 	int bytes;
 	unsigned char* pixels;
+	unsigned int changes;
 
 	bool setPixel(short x, short y, bool value);
 	int toOffset(short x, short y) const;
@@ -27,6 +45,11 @@ private:
 	int toPixel(short x, short y) const;
 	bool validPixel(short x, short y) const;
 	int readLine(bool horizontal, short line, unsigned char*& arr) const;
+	void fillBits(int first, int last, bool value);
+	void orRowBits(short x, short y, unsigned long long bits, short count);
+	void shearRows(const Frame& src, short factor);
+	void shearCols(const Frame& src, short factor);
+	short shearOffset(short factor, short line) const;
 };
 
 #endif
@@ -0,0 +1,159 @@
+// Title: FrameCache
+// Created by: Vlad Netrebchenko
+// Start Date: July 15, 2019
+// Last Modification: July 15, 2019
+
+// Description:
+// FrameCache holds diagonal frames that were not drawn by the user
+// and are instead derived from the horizontal frame the first time
+// a sprite is drawn at a diagonal rotation. A derived frame is kept
+// until its horizontal frame changes, its sprite is removed, or the
+// cache runs over its byte limit, in which case the frames that
+// have gone unused the longest are dropped first.
+
+#include "FrameCache.h"
+
+const int MIN_ENTRIES = 4;
+
+// creates empty cache that holds up to maxBytes of frame pixels
+FrameCache::FrameCache(int maxBytes) {
+	entries = nullptr;
+	count = 0;
+	capacity = 0;
+	limit = maxBytes;
+	used = 0;
+	clock = 0;
+	scratch = nullptr;
+}
+
+FrameCache::~FrameCache() {
+	clear();
+	delete[] entries;
+	delete scratch;
+}
+
+// returns diagonal frame derived from given horizontal frame
+// the frame is derived again if the horizontal frame changed since it was cached
+// returned frame stays valid until the next call
+Frame* FrameCache::getDiagonal(char spriteId, char frameId, const Frame* source) {
+	if (source == nullptr) return nullptr;
+	clock++;
+
+	int index = 0;
+	while (index < count && (entries[index].spriteId != spriteId || entries[index].frameId != frameId)) {
+		index++;
+	}
+
+	// up to date
+	if (index < count && entries[index].source == source && entries[index].version == source->version()) {
+		entries[index].lastUse = clock;
+		return entries[index].frame;
+	}
+
+	// horizontal frame changed or was replaced, so derive it again in the same frame
+	if (index < count && entries[index].frame->size() == source->size()) {
+		entries[index].frame->rotate45(*source, *scratchFor(source->size()));
+		entries[index].source = source;
+		entries[index].version = source->version();
+		entries[index].lastUse = clock;
+		return entries[index].frame;
+	}
+
+	// replaced by a frame of another size
+	if (index < count) {
+		removeAt(index);
+		index = count;
+	}
+
+	if (count == capacity) {
+		int newCapacity = (capacity < MIN_ENTRIES) ? MIN_ENTRIES : capacity * 2;
+		CacheEntry* temp = new CacheEntry[newCapacity];
+		for (int i = 0; i < count; ++i) {
+			temp[i] = entries[i];
+		}
+
+		delete[] entries;
+		entries = temp;
+		capacity = newCapacity;
+	}
+
+	Frame* frame = new Frame(source->size());
+	frame->rotate45(*source, *scratchFor(source->size()));
+	entries[count] = CacheEntry{ spriteId, frameId, source, source->version(), clock, frame };
+	used += frame->byteSize();
+	count++;
+
+	evict(index);
+	return frame;
+}
+
+// sets most bytes of frame pixels kept, dropping frames if over the new limit
+void FrameCache::setLimit(int maxBytes) {
+	limit = maxBytes;
+	evict(-1);
+}
+
+// drops every frame derived for sprite with given id
+void FrameCache::remove(char spriteId) {
+	for (int i = count - 1; i >= 0; --i) {
+		if (entries[i].spriteId == spriteId) {
+			removeAt(i);
+		}
+	}
+}
+
+// drops all frames
+void FrameCache::clear() {
+	while (count > 0) {
+		removeAt(count - 1);
+	}
+}
+
+// returns number of bytes of frame pixels kept
+int FrameCache::bytes() const {
+	return used;
+}
+
+// returns number of frames kept
+int FrameCache::size() const {
+	return count;
+}
+
+// drops least recently used frames until under the limit
+// the frame at index keep is never dropped, so the frame just derived can still be drawn
+void FrameCache::evict(int keep) {
+	while (used > limit && count > ((keep < 0) ? 0 : 1)) {
+		int oldest = (keep == 0) ? 1 : 0;
+		for (int i = 0; i < count; ++i) {
+			if (i != keep && entries[i].lastUse < entries[oldest].lastUse) {
+				oldest = i;
+			}
+		}
+
+		// last entry moves into the freed index
+		if (keep == count - 1) {
+			keep = oldest;
+		}
+		removeAt(oldest);
+	}
+}
+
+// deletes frame at given index, moving the last entry into its place
+void FrameCache::removeAt(int index) {
+	used -= entries[index].frame->byteSize();
+	delete entries[index].frame;
+
+	count--;
+	entries[index] = entries[count];
+}
+
+// returns frame of given size that derivations use between passes
+// it is only allocated again when a frame of another size is derived
+Frame* FrameCache::scratchFor(short size) {
+	if (scratch == nullptr || scratch->size() != size) {
+		delete scratch;
+		scratch = new Frame(size);
+	}
+
+	return scratch;
+}
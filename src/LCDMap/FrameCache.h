@@ -0,0 +1,43 @@
+#ifndef FRAMECACHE_H
+#define FRAMECACHE_H
+
+#include "Frame.h"
+
+using namespace std;
+
+struct CacheEntry {
+	char spriteId;
+	char frameId;
+	const Frame* source;
+	unsigned int version;
+	unsigned long lastUse;
+	Frame* frame;
+};
+
+class FrameCache {
+public:
+	FrameCache(int maxBytes);
+	~FrameCache();
+
+	Frame* getDiagonal(char spriteId, char frameId, const Frame* source);
+	void setLimit(int maxBytes);
+	void remove(char spriteId);
+	void clear();
+	int bytes() const;
+	int size() const;
+
+private:
+	CacheEntry* entries;
+	int count;
+	int capacity;
+	int limit;
+	int used;
+	unsigned long clock;
+	Frame* scratch;
+
+	void evict(int keep);
+	void removeAt(int index);
+	Frame* scratchFor(short size);
+};
+
+#endif
@@ -0,0 +1,212 @@
+// Title: FrameLoop
+// Created by: Vlad Netrebchenko
+// Start Date: July 12, 2019
+// Last Modification: July 12, 2019
+
+// Description:
+// FrameLoop paces an animation without delay(). The update callback
+// runs a fixed number of times per second no matter how long drawing
+// takes, catching up with extra updates when the loop falls behind.
+// When another update is already due, the render is skipped instead,
+// so the animation keeps its speed on slow scenes. The time spent in
+// every tick is recorded so the headroom left on a board can be read
+// back as min, average, max and 99th-percentile frame times.
+
+#include "FrameLoop.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+// returns microseconds since an arbitrary point in time
+static unsigned long defaultClock() {
+#ifdef ARDUINO
+	return micros();
+#else
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// runs update every stepMicros microseconds and render after each round of updates
+// either callback may be nullptr
+FrameLoop::FrameLoop(LCDMap& lcdMap, unsigned long stepMicros, LoopCallback update, LoopCallback render) : map(lcdMap) {
+	onUpdate = update;
+	onRender = render;
+	now = defaultClock;
+	stepTime = (stepMicros < 1) ? 1 : stepMicros;
+	maxSteps = 4;
+	maxSkipped = 4;
+	started = false;
+	last = 0;
+	lag = 0;
+	skippedInRow = 0;
+
+	resetStats();
+}
+
+// runs any updates that are due, then renders unless the loop is behind
+// call as often as possible, for example from loop()
+// returns true if a frame was rendered
+bool FrameLoop::tick() {
+	unsigned long start = now();
+
+	// first tick updates straight away
+	if (!started) {
+		started = true;
+		last = start;
+		lag = stepTime;
+	}
+
+	lag += start - last;
+	last = start;
+	if (lag < stepTime) return false;
+
+	// catch up on missed updates, dropping what is left after maxSteps
+	for (short steps = 0; lag >= stepTime; ++steps) {
+		if (steps == maxSteps) {
+			lag %= stepTime;
+			break;
+		}
+
+		if (onUpdate != nullptr) {
+			onUpdate(map);
+		}
+		lag -= stepTime;
+	}
+
+	unsigned long updated = now();
+	unsigned long updateTime = updated - start;
+
+	// skip the render if the next update is already due
+	if (lag + updateTime >= stepTime && skippedInRow < maxSkipped) {
+		skippedInRow++;
+		skipCount++;
+		addFrame(updateTime, updateTime, 0, false);
+		return false;
+	}
+
+	if (onRender != nullptr) {
+		onRender(map);
+	}
+	skippedInRow = 0;
+
+	unsigned long rendered = now();
+	addFrame(rendered - start, updateTime, rendered - updated, true);
+	return true;
+}
+
+// sets function returning the current time in microseconds (micros() by default)
+void FrameLoop::setClock(LoopClock clock) {
+	now = (clock == nullptr) ? defaultClock : clock;
+	started = false;
+}
+
+// sets most updates run in a single tick before the loop gives up catching up
+void FrameLoop::setMaxSteps(short steps) {
+	maxSteps = (steps < 1) ? 1 : steps;
+}
+
+// sets most renders skipped in a row, so the screen still changes on overloaded boards
+void FrameLoop::setMaxSkipped(short frames) {
+	maxSkipped = (frames < 0) ? 0 : frames;
+}
+
+// clears all timing statistics
+void FrameLoop::resetStats() {
+	frameCount = 0;
+	skipCount = 0;
+	minTime = 0;
+	maxTime = 0;
+	meanTime = 0;
+	meanUpdate = 0;
+	meanRender = 0;
+
+	for (int i = 0; i < FRAME_BINS; ++i) {
+		bins[i] = 0;
+	}
+}
+
+// returns microseconds between updates
+unsigned long FrameLoop::step() const {
+	return stepTime;
+}
+
+// returns number of ticks that ran at least one update
+unsigned long FrameLoop::frames() const {
+	return frameCount;
+}
+
+// returns number of renders skipped because the loop was behind
+unsigned long FrameLoop::skipped() const {
+	return skipCount;
+}
+
+// returns shortest tick, in microseconds
+unsigned long FrameLoop::minFrame() const {
+	return minTime;
+}
+
+// returns average tick, in microseconds
+unsigned long FrameLoop::avgFrame() const {
+	return meanTime;
+}
+
+// returns longest tick, in microseconds
+unsigned long FrameLoop::maxFrame() const {
+	return maxTime;
+}
+
+// returns time that 99% of ticks finished within, in microseconds
+// rounded up to the next 1/16 of the step, but never above the longest tick;
+// ticks longer than two steps are counted as two steps
+unsigned long FrameLoop::p99Frame() const {
+	// target comes from the bins themselves, so it always matches what they hold
+	unsigned long total = 0;
+	for (int i = 0; i < FRAME_BINS; ++i) {
+		total += bins[i];
+	}
+
+	unsigned long target = total - total / 100;
+	unsigned long count = 0;
+
+	for (int i = 0; i < FRAME_BINS; ++i) {
+		count += bins[i];
+		if (count >= target && count > 0) {
+			unsigned long edge = (i + 1) * stepTime * 2 / FRAME_BINS;
+			return (edge > maxTime) ? maxTime : edge;
+		}
+	}
+
+	return 0;
+}
+
+// returns average time spent in update callbacks per tick, in microseconds
+unsigned long FrameLoop::avgUpdate() const {
+	return meanUpdate;
+}
+
+// returns average time spent in the render callback, in microseconds
+// skipped renders are not counted
+unsigned long FrameLoop::avgRender() const {
+	return meanRender;
+}
+
+// adds tick to the statistics
+void FrameLoop::addFrame(unsigned long frameTime, unsigned long updateTime, unsigned long renderTime, bool rendered) {
+	frameCount++;
+	minTime = (frameCount == 1 || frameTime < minTime) ? frameTime : minTime;
+	maxTime = (frameTime > maxTime) ? frameTime : maxTime;
+	meanTime += (frameTime - meanTime) / frameCount;
+	meanUpdate += (updateTime - meanUpdate) / frameCount;
+
+	if (rendered) {
+		meanRender += (renderTime - meanRender) / (frameCount - skipCount);
+	}
+
+	// bins split two steps evenly, the last one also holds anything longer
+	unsigned long span = stepTime * 2;
+	bins[(frameTime >= span) ? FRAME_BINS - 1 : frameTime * FRAME_BINS / span]++;
+}
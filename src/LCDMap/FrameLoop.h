@@ -0,0 +1,58 @@
+#ifndef FRAMELOOP_H
+#define FRAMELOOP_H
+
+#include "LCDMap.h"
+
+using namespace std;
+
+typedef void (*LoopCallback)(LCDMap& map);
+typedef unsigned long (*LoopClock)();
+
+const short FRAME_BINS = 32;
+
+class FrameLoop {
+public:
+	FrameLoop(LCDMap& lcdMap, unsigned long stepMicros, LoopCallback update, LoopCallback render);
+
+	bool tick();
+	void setClock(LoopClock clock);
+	void setMaxSteps(short steps);
+	void setMaxSkipped(short frames);
+	void resetStats();
+
+	unsigned long step() const;
+	unsigned long frames() const;
+	unsigned long skipped() const;
+	unsigned long minFrame() const;
+	unsigned long avgFrame() const;
+	unsigned long maxFrame() const;
+	unsigned long p99Frame() const;
+	unsigned long avgUpdate() const;
+	unsigned long avgRender() const;
+
+private:
+	LCDMap& map;
+	LoopCallback onUpdate;
+	LoopCallback onRender;
+	LoopClock now;
+	unsigned long stepTime;
+	short maxSteps;
+	short maxSkipped;
+	bool started;
+	unsigned long last;
+	unsigned long lag;
+	short skippedInRow;
+
+	unsigned long frameCount;
+	unsigned long skipCount;
+	unsigned long minTime;
+	unsigned long maxTime;
+	float meanTime;
+	float meanUpdate;
+	float meanRender;
+	unsigned long bins[FRAME_BINS];
+
+	void addFrame(unsigned long frameTime, unsigned long updateTime, unsigned long renderTime, bool rendered);
+};
+
+#endif
@@ -0,0 +1,247 @@
+// Title: FrameStream
+// Created by: Vlad Netrebchenko
+// Start Date: July 11, 2019
+// Last Modification: July 11, 2019
+
+// Description:
+// FrameStream plays an animation whose frames are read on demand
+// from a FrameSource (flash, SD card, serial, or a file on a computer)
+// instead of being kept in memory for the lifetime of the sprite.
+// A small ring of frames is filled ahead of time, a few bytes at a
+// time and only from bytes that are already available, so advancing
+// to the next frame never waits on the source.
+//
+// Each frame in the source is the horizontal frame's bytes followed
+// by the diagonal frame's bytes, in the row-wrapped order Frame uses.
+// A stream created without diagonal frames holds only the horizontal
+// frame's bytes, and LCDMap derives the diagonal frame when needed.
+
+#include "FrameStream.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#endif
+
+const int CHUNK = 16;
+const int MAX_AVAILABLE = 0x7FFF;
+
+// reads frames from given byte array
+// if progmem is true, array is read from flash (AVR only)
+MemoryFrameSource::MemoryFrameSource(const unsigned char* data, long length, bool progmem) {
+	bytes = data;
+	size = length;
+	pos = 0;
+	flash = progmem;
+}
+
+// returns number of bytes left in the array
+int MemoryFrameSource::available() {
+	long left = size - pos;
+	return (left > MAX_AVAILABLE) ? MAX_AVAILABLE : left;
+}
+
+// copies up to length bytes into buffer
+// returns number of bytes copied
+int MemoryFrameSource::read(unsigned char* buffer, int length) {
+	int count = 0;
+
+	while (count < length && pos < size) {
+#ifdef __AVR__
+		buffer[count++] = flash ? pgm_read_byte(bytes + pos) : bytes[pos];
+#else
+		buffer[count++] = bytes[pos];
+#endif
+		pos++;
+	}
+
+	return count;
+}
+
+// returns true once every byte has been read
+bool MemoryFrameSource::atEnd() {
+	return pos >= size;
+}
+
+// starts reading from the beginning of the array again
+bool MemoryFrameSource::rewind() {
+	pos = 0;
+	return true;
+}
+
+#ifndef ARDUINO
+// reads frames from given file, starting at its current position
+FileFrameSource::FileFrameSource(FILE* input) {
+	in = input;
+}
+
+// returns number of bytes left in the file
+int FileFrameSource::available() {
+	long pos = ftell(in);
+	fseek(in, 0, SEEK_END);
+	long left = ftell(in) - pos;
+	fseek(in, pos, SEEK_SET);
+
+	return (left > MAX_AVAILABLE) ? MAX_AVAILABLE : left;
+}
+
+// reads up to length bytes into buffer
+// returns number of bytes read
+int FileFrameSource::read(unsigned char* buffer, int length) {
+	return fread(buffer, 1, length, in);
+}
+
+// returns true once every byte has been read
+bool FileFrameSource::atEnd() {
+	return available() == 0;
+}
+
+// starts reading from the beginning of the file again
+bool FileFrameSource::rewind() {
+	return fseek(in, 0, SEEK_SET) == 0;
+}
+#endif
+
+// creates stream of frames of given side length, buffering up to slots frames
+// (including the one on screen); if loop is true, the source is rewound at its end
+// if diagonal is false, the source holds only horizontal frames
+FrameStream::FrameStream(FrameSource* source, short sideLength, short slots, bool loop, bool diagonal) {
+	in = source;
+	length = (sideLength < 1) ? 1 : sideLength;
+	slotCount = (slots < 2) ? 2 : slots;
+	looping = loop;
+	diagonals = diagonal;
+	head = 0;
+	ready = 0;
+	filled = 0;
+	stallCount = 0;
+	playCount = 0;
+
+	framesH = new Frame*[slotCount];
+	framesD = diagonals ? new Frame*[slotCount] : nullptr;
+	for (int i = 0; i < slotCount; ++i) {
+		framesH[i] = new Frame(length);
+		if (diagonals) {
+			framesD[i] = new Frame(length);
+		}
+	}
+
+	prefetch();
+}
+
+FrameStream::~FrameStream() {
+	for (int i = 0; i < slotCount; ++i) {
+		delete framesH[i];
+		if (diagonals) {
+			delete framesD[i];
+		}
+	}
+
+	delete[] framesH;
+	delete[] framesD;
+}
+
+// returns horizontal frame on screen, or nullptr if no frame has been read yet
+Frame* FrameStream::currentH() const {
+	return (ready == 0) ? nullptr : framesH[head];
+}
+
+// returns diagonal frame on screen, or nullptr if no frame has been read yet
+// or the stream has no diagonal frames
+Frame* FrameStream::currentD() const {
+	return (ready == 0 || !diagonals) ? nullptr : framesD[head];
+}
+
+// moves on to the next buffered frame and refills the buffer
+// if the next frame has not been read yet, the current frame stays on screen
+// and the stall is counted
+// returns true if the frame changed
+bool FrameStream::next() {
+	prefetch();
+
+	if (ready < 2) {
+		if (!in->atEnd() || looping) {
+			stallCount++;
+		}
+		return false;
+	}
+
+	head = (head + 1) % slotCount;
+	ready--;
+	playCount++;
+
+	prefetch();
+	return true;
+}
+
+// reads as many frames into free slots as the source has bytes available for
+// never waits for the source
+void FrameStream::prefetch() {
+	bool rewound = false;
+
+	while (ready < slotCount) {
+		if (fillSlot((head + ready) % slotCount)) {
+			ready++;
+			filled = 0;
+		} else if (looping && !rewound && in->atEnd()) {
+			// drop any partial frame at the end of the source and start over
+			rewound = true;
+			filled = 0;
+			if (!in->rewind()) return;
+		} else {
+			return;
+		}
+	}
+}
+
+// returns side length of the frames
+short FrameStream::size() const {
+	return length;
+}
+
+// returns number of times next() was called before the next frame was read
+unsigned long FrameStream::stalls() const {
+	return stallCount;
+}
+
+// returns number of frames played so far
+unsigned long FrameStream::played() const {
+	return playCount;
+}
+
+// returns number of frames read and waiting behind the one on screen
+short FrameStream::buffered() const {
+	return (ready == 0) ? 0 : ready - 1;
+}
+
+// returns number of frames that can wait behind the one on screen
+short FrameStream::capacity() const {
+	return slotCount - 1;
+}
+
+// continues reading the frame in given slot from the available bytes
+// returns true once both its horizontal and diagonal frame have been read
+bool FrameStream::fillSlot(short slot) {
+	int frameBytes = framesH[slot]->byteSize();
+	int totalBytes = diagonals ? frameBytes * 2 : frameBytes;
+	unsigned char chunk[CHUNK];
+
+	while (filled < totalBytes) {
+		int count = totalBytes - filled;
+		int available = in->available();
+		if (available <= 0) return false;
+
+		count = (count > available) ? available : count;
+		count = (count > CHUNK) ? CHUNK : count;
+		count = in->read(chunk, count);
+		if (count <= 0) return false;
+
+		// first bytes go to the horizontal frame, the rest to the diagonal one
+		int copied = framesH[slot]->writeBytes(filled, chunk, count);
+		if (diagonals) {
+			framesD[slot]->writeBytes(filled + copied - frameBytes, chunk + copied, count - copied);
+		}
+		filled += count;
+	}
+
+	return true;
+}
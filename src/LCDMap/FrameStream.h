@@ -0,0 +1,97 @@
+#ifndef FRAMESTREAM_H
+#define FRAMESTREAM_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdio.h>
+#endif
+
+#include "Frame.h"
+
+using namespace std;
+
+class FrameSource {
+public:
+	virtual ~FrameSource() {}
+	virtual int available() = 0;
+	virtual int read(unsigned char* buffer, int length) = 0;
+	virtual bool atEnd() { return false; }
+	virtual bool rewind() { return false; }
+};
+
+class MemoryFrameSource : public FrameSource {
+public:
+	MemoryFrameSource(const unsigned char* data, long length, bool progmem = false);
+
+	int available();
+	int read(unsigned char* buffer, int length);
+	bool atEnd();
+	bool rewind();
+
+private:
+	const unsigned char* bytes;
+	long size;
+	long pos;
+	bool flash;
+};
+
+#ifdef ARDUINO
+class StreamFrameSource : public FrameSource {
+public:
+	StreamFrameSource(Stream& input) : in(input) {}
+	int available() { return in.available(); }
+	int read(unsigned char* buffer, int length) { return in.readBytes(buffer, length); }
+
+private:
+	Stream& in;
+};
+#else
+class FileFrameSource : public FrameSource {
+public:
+	FileFrameSource(FILE* input);
+
+	int available();
+	int read(unsigned char* buffer, int length);
+	bool atEnd();
+	bool rewind();
+
+private:
+	FILE* in;
+};
+#endif
+
+class FrameStream {
+public:
+	FrameStream(FrameSource* source, short sideLength, short slots, bool loop = true, bool diagonal = true);
+	~FrameStream();
+
+	Frame* currentH() const;
+	Frame* currentD() const;
+	bool next();
+	void prefetch();
+	short size() const;
+
+	unsigned long stalls() const;
+	unsigned long played() const;
+	short buffered() const;
+	short capacity() const;
+
+private:
+	FrameSource* in;
+	short length;
+	short slotCount;
+	bool looping;
+	bool diagonals;
+	Frame** framesH;
+	Frame** framesD;
+	short head;
+	short ready;
+	int filled;
+	unsigned long stallCount;
+	unsigned long playCount;
+
+	bool fillSlot(short slot);
+};
+
+#endif
@@ -0,0 +1,251 @@
+// Title: Framebuffer
+// Created by: Vlad Netrebchenko
+// Start Date: July 13, 2019
+// Last Modification: July 13, 2019
+
+// Description:
+// Framebuffer is a render target for graphical LCDs (KS0108, ST7920
+// and similar, such as 128x64 or 240x64) where the 5x8 character
+// model of readCharacter does not apply. Pixels are packed one bit
+// each into 64-bit words, so whole sprite rows are drawn with a
+// shift and an OR. The screen is split into pages of 8 rows by 64
+// columns, and flush() only sends the pages that changed since the
+// last flush to the GraphicController.
+//
+// By default only one copy of the screen is kept (1 KB for 128x64,
+// 2 KB for 240x64), and every page marked as changed is sent. With
+// keepSent, a second copy of what was last sent is kept as well,
+// so pages redrawn with the same pixels are not sent again, at
+// twice the memory.
+
+#include "Framebuffer.h"
+
+// creates blank framebuffer of given size in pixels
+// keepSent keeps a copy of the pixels last sent, to skip pages that were redrawn unchanged
+Framebuffer::Framebuffer(short pixelWidth, short pixelHeight, bool keepSent) {
+	wdth = (pixelWidth < 1) ? 1 : pixelWidth;
+	hght = (pixelHeight < 1) ? 1 : pixelHeight;
+	words = (wdth + SEGMENT_COLS - 1) / SEGMENT_COLS;
+	pageCount = (hght + PAGE_ROWS - 1) / PAGE_ROWS;
+
+	int total = hght * words;
+	pixels = new unsigned long long[total];
+	sent = keepSent ? new unsigned long long[total] : nullptr;
+	for (int i = 0; i < total; ++i) {
+		pixels[i] = 0;
+		if (sent != nullptr) {
+			sent[i] = 0;
+		}
+	}
+
+	int dirtyBytes = (pageCount * words + 7) / 8;
+	dirty = new unsigned char[dirtyBytes];
+	for (int i = 0; i < dirtyBytes; ++i) {
+		dirty[i] = 0;
+	}
+}
+
+Framebuffer::~Framebuffer() {
+	delete[] pixels;
+	delete[] sent;
+	delete[] dirty;
+}
+
+// returns width in pixels
+short Framebuffer::width() const {
+	return wdth;
+}
+
+// returns height in pixels
+short Framebuffer::height() const {
+	return hght;
+}
+
+// returns number of 8-row pages
+short Framebuffer::pages() const {
+	return pageCount;
+}
+
+// returns number of 64-column segments in every page
+short Framebuffer::segments() const {
+	return words;
+}
+
+// returns value of pixel at given position
+// returns false if position is out of bounds
+bool Framebuffer::getPixel(short x, short y) const {
+	if (x < 0 || x >= wdth || y < 0 || y >= hght) return false;
+
+	return (pixels[y * words + x / SEGMENT_COLS] >> (63 - x % SEGMENT_COLS)) & 1;
+}
+
+// draws count pixels (up to 64) starting at (x, y), the first being the
+// most significant bit of bits; pixels outside the screen are dropped
+void Framebuffer::drawRow(int x, int y, unsigned long long bits, short count) {
+	if (y < 0 || y >= hght || count < 1 || x >= wdth || x + count <= 0) return;
+	if (count < 64) {
+		bits &= ~(~0ULL >> count);
+	}
+
+	// cut off pixels left of the screen
+	if (x < 0) {
+		bits <<= -x;
+		x = 0;
+	}
+
+	short word = x / SEGMENT_COLS;
+	short shift = x % SEGMENT_COLS;
+	short page = y / PAGE_ROWS;
+	unsigned long long* row = pixels + y * words;
+
+	row[word] |= bits >> shift;
+	markDirty(page, word);
+
+	if (shift > 0 && word + 1 < words && (bits << (64 - shift)) != 0) {
+		row[word + 1] |= bits << (64 - shift);
+		markDirty(page, word + 1);
+	}
+
+	// cut off pixels right of the screen
+	short spare = words * SEGMENT_COLS - wdth;
+	if (spare > 0) {
+		row[words - 1] &= ~0ULL << spare;
+	}
+}
+
+// clears all pixels, marking every page that had any lit as changed
+void Framebuffer::clear() {
+	for (short y = 0; y < hght; ++y) {
+		for (short word = 0; word < words; ++word) {
+			if (pixels[y * words + word] != 0) {
+				pixels[y * words + word] = 0;
+				markDirty(y / PAGE_ROWS, word);
+			}
+		}
+	}
+}
+
+// sends every page marked as changed
+// with keepSent, pages whose pixels are the same as last sent are skipped
+// returns number of pages sent
+int Framebuffer::flush(GraphicController& controller) {
+	unsigned long long rows[PAGE_ROWS];
+	int count = 0;
+
+	for (short page = 0; page < pageCount; ++page) {
+		for (short word = 0; word < words; ++word) {
+			if (!isDirty(page, word)) continue;
+
+			bool changed = (sent == nullptr);
+			for (short i = 0; i < PAGE_ROWS; ++i) {
+				short y = page * PAGE_ROWS + i;
+				rows[i] = (y < hght) ? pixels[y * words + word] : 0;
+				if (sent != nullptr && y < hght && rows[i] != sent[y * words + word]) {
+					sent[y * words + word] = rows[i];
+					changed = true;
+				}
+			}
+
+			if (changed) {
+				controller.writePage(page, word, rows);
+				count++;
+			}
+		}
+	}
+
+	int dirtyBytes = (pageCount * words + 7) / 8;
+	for (int i = 0; i < dirtyBytes; ++i) {
+		dirty[i] = 0;
+	}
+
+	return count;
+}
+
+// turns 8 rows of 64 pixels into 64 column bytes, as KS0108 controllers expect them
+// bit 0 of every column is the top row
+void Framebuffer::toColumns(const unsigned long long* rows, unsigned char* columns) {
+	for (short block = 0; block < 8; ++block) {
+		// gather one byte of every row, top row in the lowest byte
+		unsigned long long x = 0;
+		short shift = 56 - block * 8;
+		for (short i = 0; i < PAGE_ROWS; ++i) {
+			x |= ((rows[i] >> shift) & 0xFF) << (i * 8);
+		}
+
+		// transpose the 8x8 block of bits
+		unsigned long long t;
+		t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+		x = x ^ t ^ (t << 7);
+		t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+		x = x ^ t ^ (t << 14);
+		t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+		x = x ^ t ^ (t << 28);
+
+		for (short i = 0; i < 8; ++i) {
+			columns[block * 8 + i] = x >> (56 - i * 8);
+		}
+	}
+}
+
+// marks page segment as changed
+void Framebuffer::markDirty(short page, short segment) {
+	int bit = page * words + segment;
+	dirty[bit / 8] |= 1 << (bit % 8);
+}
+
+// returns true if page segment was marked as changed
+bool Framebuffer::isDirty(short page, short segment) const {
+	int bit = page * words + segment;
+	return (dirty[bit / 8] >> (bit % 8)) & 1;
+}
+
+// creates controller that keeps the screen in memory, as KS0108 column bytes
+MockController::MockController(short pixelWidth, short pixelHeight) {
+	wdth = pixelWidth;
+	hght = pixelHeight;
+	words = (wdth + SEGMENT_COLS - 1) / SEGMENT_COLS;
+
+	int total = ((hght + PAGE_ROWS - 1) / PAGE_ROWS) * words * SEGMENT_COLS;
+	columns = new unsigned char[total];
+	for (int i = 0; i < total; ++i) {
+		columns[i] = 0;
+	}
+
+	resetCounts();
+}
+
+MockController::~MockController() {
+	delete[] columns;
+}
+
+// stores page as column bytes and counts the bytes a real controller would receive
+void MockController::writePage(short page, short segment, const unsigned long long* rows) {
+	Framebuffer::toColumns(rows, columns + (page * words + segment) * SEGMENT_COLS);
+
+	pageCount++;
+	byteCount += SEGMENT_COLS;
+}
+
+// returns value of pixel at given position, as last written
+bool MockController::getPixel(short x, short y) const {
+	if (x < 0 || x >= wdth || y < 0 || y >= hght) return false;
+
+	int segment = (y / PAGE_ROWS) * words + x / SEGMENT_COLS;
+	return (columns[segment * SEGMENT_COLS + x % SEGMENT_COLS] >> (y % PAGE_ROWS)) & 1;
+}
+
+// returns number of pages written
+unsigned long MockController::pagesWritten() const {
+	return pageCount;
+}
+
+// returns number of bytes written
+unsigned long MockController::bytesWritten() const {
+	return byteCount;
+}
+
+// sets written page and byte counts to 0
+void MockController::resetCounts() {
+	pageCount = 0;
+	byteCount = 0;
+}
@@ -0,0 +1,64 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+using namespace std;
+
+const short PAGE_ROWS = 8;
+const short SEGMENT_COLS = 64;
+
+class GraphicController {
+public:
+	virtual ~GraphicController() {}
+	virtual void writePage(short page, short segment, const unsigned long long* rows) = 0;
+};
+
+class Framebuffer {
+public:
+	Framebuffer(short pixelWidth, short pixelHeight, bool keepSent = false);
+	~Framebuffer();
+
+	short width() const;
+	short height() const;
+	short pages() const;
+	short segments() const;
+	bool getPixel(short x, short y) const;
+	void drawRow(int x, int y, unsigned long long bits, short count);
+	void clear();
+	int flush(GraphicController& controller);
+
+	static void toColumns(const unsigned long long* rows, unsigned char* columns);
+
+private:
+	short wdth;
+	short hght;
+	short words;
+	short pageCount;
+	unsigned long long* pixels;
+	unsigned long long* sent;
+	unsigned char* dirty;
+
+	void markDirty(short page, short segment);
+	bool isDirty(short page, short segment) const;
+};
+
+class MockController : public GraphicController {
+public:
+	MockController(short pixelWidth, short pixelHeight);
+	~MockController();
+
+	void writePage(short page, short segment, const unsigned long long* rows);
+	bool getPixel(short x, short y) const;
+	unsigned long pagesWritten() const;
+	unsigned long bytesWritten() const;
+	void resetCounts();
+
+private:
+	short wdth;
+	short hght;
+	short words;
+	unsigned char* columns;
+	unsigned long pageCount;
+	unsigned long byteCount;
+};
+
+#endif
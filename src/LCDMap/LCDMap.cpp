@@ -1,7 +1,7 @@
 // Title: LCDMap
 // Created by: Vlad Netrebchenko
 // Start Date: June 28, 2019
-// Last Modification: July 8, 2019
+// Last Modification: July 15, 2019
 
 // Description:
 // LCDMap acts as an overlay to the Arduino LCD screen
@@ -9,25 +9,48 @@
 // The user is able to create sprites which move in the x
 // and y axis and take on multiple frames, which can
 // be read directly into LiquidCrystal createChar() and
-// promptly displayed on the screen
+// promptly displayed on the screen. Sprites can be grouped
+// under a parent sprite, so moving or rotating the parent
+// moves and rotates the whole group. Diagonal frames are
+// optional; when one isn't drawn, it is derived from the
+// horizontal frame and kept in a small cache
 
 #include "LCDMap.h"
 
+// x and y step for each heading, indexed by rotation / 45 (0 degrees points up)
+const short DIR_X[] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+const short DIR_Y[] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+
+// bytes of derived diagonal frames kept until setCacheLimit() is called
+const int CACHE_BYTES = 256;
+
+// cache id of the diagonal frame derived for a streamed sprite
+const char STREAM_FRAME = 0;
+
 // takes height and width (in pixels) of LCD character
-LCDMap::LCDMap(short charWidth, short charHeight) {
+LCDMap::LCDMap(short charWidth, short charHeight) : cache(CACHE_BYTES) {
 	charWdth = charWidth;
 	charHght = charHeight;
+	recorder = nullptr;
+	handles = nullptr;
+	handleCount = 0;
+	handleCapacity = 0;
+	worldDirty = true;
 
 	removeBounds();
 }
 
 LCDMap::~LCDMap() {
 	sprites.clear();
+	transforms.clear();
+	delete[] handles;
 }
 
 // sets bounds that no sprite can step past
 // count is number of pixels away from the first character
 void LCDMap::setBounds(int top, int right, int bottom, int left) {
+    record(TRACE_SET_BOUNDS, top, right, bottom, left);
+
     topBound = top;
     rightBound = right;
     bottomBound = bottom;
@@ -36,6 +59,8 @@ void LCDMap::setBounds(int top, int right, int bottom, int left) {
 
 // sets bounds to infinity
 void LCDMap::removeBounds() {
+    record(TRACE_REMOVE_BOUNDS);
+
     topBound = MAX;
     rightBound = MAX;
     bottomBound = MAX;
@@ -43,114 +68,308 @@ void LCDMap::removeBounds() {
 }
 
 // returns true if sprite is touching the bounds
+// a sprite in a group is touching the bounds when its whole group is
 bool LCDMap::atBounds(char id) const {
     return atTopBounds(id) || atRigBounds(id) || atBotBounds(id) || atLefBounds(id);
 }
 
 // returns true if sprite touching top bounds
 bool LCDMap::atTopBounds(char id) const {
-    Sprite* sprite = sprites.get(id);
+    short slot = getRootSlot(id);
+    if (slot == ERROR) return false;
 
-    return (sprite == nullptr) ? false : sprite->y == -topBound;
+    return transforms.boxTop[slot] <= -topBound;
 }
 
 // returns true if sprite touching right bounds
 bool LCDMap::atRigBounds(char id) const {
-    Sprite* sprite = sprites.get(id);
+    short slot = getRootSlot(id);
+    if (slot == ERROR) return false;
 
-    return (sprite == nullptr) ? false : sprite->x + sprite->size == rightBound + charWdth;
+    return transforms.boxRight[slot] >= rightBound + charWdth;
 }
 
 // returns true if sprite touching bottom bounds
 bool LCDMap::atBotBounds(char id) const {
-    Sprite* sprite = sprites.get(id);
+    short slot = getRootSlot(id);
+    if (slot == ERROR) return false;
 
-    return (sprite == nullptr) ? false : sprite->y + sprite->size == bottomBound + charHght;
+    return transforms.boxBottom[slot] >= bottomBound + charHght;
 }
 
 // returns true if sprite touching left bounds
 bool LCDMap::atLefBounds(char id) const {
-    Sprite* sprite = sprites.get(id);
+    short slot = getRootSlot(id);
+    if (slot == ERROR) return false;
 
-    return (sprite == nullptr) ? false : sprite->x == -leftBound;
+    return transforms.boxLeft[slot] <= -leftBound;
 }
 
-// returns x position of sprite with given id
+// returns x position of sprite with given id, relative to its parent if it has one
 int LCDMap::getSpriteX(char id) const {
-	Sprite* sprite = sprites.get(id);
+	short slot = getSlot(id);
 
-	return (sprite == nullptr) ? ERROR : sprite->x;
+	return (slot == ERROR) ? ERROR : transforms.x[slot];
 }
 
-// returns y position of sprite with given id
+// returns y position of sprite with given id, relative to its parent if it has one
 int LCDMap::getSpriteY(char id) const {
-	Sprite* sprite = sprites.get(id);
+	short slot = getSlot(id);
 
-	return (sprite == nullptr) ? ERROR : sprite->y;
+	return (slot == ERROR) ? ERROR : transforms.y[slot];
 }
 
-// returns rotation of sprite with given id
+// returns rotation of sprite with given id, relative to its parent if it has one
 short LCDMap::getSpriteRot(char id) const {
-	Sprite* sprite = sprites.get(id);
+	short slot = getSlot(id);
+
+	return (slot == ERROR) ? ERROR : transforms.rotation[slot];
+}
+
+// returns velocity (pixels per step) of sprite with given id
+int LCDMap::getSpriteVelocity(char id) const {
+	short slot = getSlot(id);
 
-	return (sprite == nullptr) ? ERROR : sprite->rotation;
+	return (slot == ERROR) ? ERROR : transforms.velocity[slot];
 }
 
 // moves sprite with given id by given amount
 void LCDMap::shiftSprite(char id, int x, int y) {
-	Sprite* sprite = sprites.get(id);
-	
-	if (sprite != nullptr) {
-	    int shiftLeft = -leftBound - sprite->x;
-	    int shiftTop = -topBound - sprite->y;
-	    int shiftRight = (charWdth + rightBound) - (sprite->x + sprite->size);
-	    int shiftBottom = (charHght + bottomBound) - (sprite->y + sprite->size);
+	record(TRACE_SHIFT, id, x, y);
 
-	    sprite->x += (shiftLeft > x) ? shiftLeft : (shiftRight < x) ? shiftRight : x;
-	    sprite->y += (shiftTop > y) ? shiftTop : (shiftBottom < y) ? shiftBottom : y;
+	short slot = getSlot(id);
+
+	if (slot != ERROR) {
+	    moveSlot(slot, x, y);
+	}
+}
+
+// moves sprite with given id by given amount in the direction of its rotation
+// diagonal rotations move the given amount along both axes
+void LCDMap::shiftSpriteForward(char id, int pixels) {
+	record(TRACE_SHIFT_FORWARD, id, pixels);
+
+	short slot = getSlot(id);
+
+	if (slot != ERROR) {
+	    short heading = transforms.rotation[slot] / 45;
+	    moveSlot(slot, DIR_X[heading] * pixels, DIR_Y[heading] * pixels);
 	}
 }
 
 // rotates sprite with given id by the given rotation
 // rotaion must be a multiple of 45 degrees
 void LCDMap::rotateSprite(char id, short degrees) {
+	record(TRACE_ROTATE, id, degrees);
+
 	if (degrees % 45 != 0) return;
 
-	Sprite* sprite = sprites.get(id);
+	short slot = getSlot(id);
 	
-	if (sprite != nullptr) {
-		sprite->rotation += (360 + (degrees % 360));
-		sprite->rotation %= 360;
+	if (slot != ERROR) {
+		transforms.rotation[slot] += (360 + (degrees % 360));
+		transforms.rotation[slot] %= 360;
+		worldDirty = true;
 	}
 }
 
+// sets number of pixels sprite with given id moves forward on every step
+void LCDMap::setSpriteVelocity(char id, int pixels) {
+	record(TRACE_SET_VELOCITY, id, pixels);
+
+	short slot = getSlot(id);
+
+	if (slot != ERROR) {
+		transforms.velocity[slot] = pixels;
+	}
+}
+
+// moves every sprite forward by its velocity for dt steps, stopping at the bounds
+// runs over the transform arrays directly, without looking up sprites by id
+// sprites with a parent move relative to it and are not stopped by the bounds
+void LCDMap::stepAll(int dt) {
+	record(TRACE_STEP_ALL, dt);
+	worldDirty = true;
+
+	int* posX = transforms.x;
+	int* posY = transforms.y;
+	const short* rotation = transforms.rotation;
+	const int* velocity = transforms.velocity;
+	const short* parent = transforms.parent;
+
+	int minX = -leftBound;
+	int minY = -topBound;
+	int maxX = charWdth + rightBound;
+	int maxY = charHght + bottomBound;
+
+	// children move freely within their group
+	for (int i = 0; i < transforms.count; ++i) {
+		if (parent[i] < 0) continue;
+
+		short heading = rotation[i] / 45;
+		int distance = velocity[i] * dt;
+		posX[i] += DIR_X[heading] * distance;
+		posY[i] += DIR_Y[heading] * distance;
+	}
+	resolve();
+
+	// whole groups stop at the bounds, measured by the box around the group
+	for (int i = 0; i < transforms.count; ++i) {
+		if (parent[i] >= 0) continue;
+
+		short heading = rotation[i] / 45;
+		int distance = velocity[i] * dt;
+		int x = posX[i] + DIR_X[heading] * distance;
+		int y = posY[i] + DIR_Y[heading] * distance;
+		int limitX = maxX - (transforms.boxRight[i] - posX[i]);
+		int limitY = maxY - (transforms.boxBottom[i] - posY[i]);
+		int lowX = minX - (transforms.boxLeft[i] - posX[i]);
+		int lowY = minY - (transforms.boxTop[i] - posY[i]);
+
+		x = (x > limitX) ? limitX : x;
+		y = (y > limitY) ? limitY : y;
+		posX[i] = (x < lowX) ? lowX : x;
+		posY[i] = (y < lowY) ? lowY : y;
+	}
+	worldDirty = true;
+}
+
 // creates new sprite at position (0, 0)
 bool LCDMap::createSprite(char id, short sideLength) {
+	record(TRACE_CREATE, id, sideLength);
+
 	if (sprites.contains(id)) return false;
 
 	Sprite* sprite = new Sprite();
-	sprite->x = 0;
-	sprite->y = 0;
-	sprite->rotation = 0;
-	sprite->size = sideLength;
+	sprite->slot = transforms.add(id, sideLength);
+	sprite->stream = nullptr;
+	worldDirty = true;
 	return sprites.add(id, sprite);
 }
 
 // removes sprite with given id
 bool LCDMap::removeSprite(char id) {
+	record(TRACE_REMOVE, id);
+
+	Sprite* sprite = sprites.get(id);
+	if (sprite == nullptr) return false;
+
+	// children stay where they are on screen, without a parent
+	for (int i = 0; i < transforms.count; ++i) {
+		if (transforms.parent[i] == sprite->slot) {
+			int x, y;
+			short rotation;
+			toWorld(i, x, y, rotation);
+			transforms.parent[i] = -1;
+			toLocal(i, x, y, rotation);
+		}
+	}
+	worldDirty = true;
+	cache.remove(id);
+	untrack(id);
+
+	// last sprite takes over the freed slot
+	short slot = sprite->slot;
+	if (transforms.remove(slot)) {
+		sprites.get(transforms.ids[slot])->slot = slot;
+	}
+
 	return sprites.remove(id);
 }
 
-// adds horizontal and diagonal frame to sprite with given id
+// makes sprite with given id a child of sprite with parentId
+// its current position and rotation become its offset from the parent, and from then
+// on it moves and rotates with the parent; parents can have parents of their own
+// returns false if either sprite doesn't exist or parentId is one of its children
+bool LCDMap::setParent(char id, char parentId) {
+	record(TRACE_SET_PARENT, id, parentId);
+
+	short slot = getSlot(id);
+	short parentSlot = getSlot(parentId);
+	if (slot == ERROR || parentSlot == ERROR) return false;
+
+	for (short i = parentSlot; i >= 0; i = transforms.parent[i]) {
+		if (i == slot) return false;
+	}
+
+	// sprite stays where it is on screen
+	int x, y;
+	short rotation;
+	toWorld(slot, x, y, rotation);
+	transforms.parent[slot] = parentSlot;
+	toLocal(slot, x, y, rotation);
+
+	worldDirty = true;
+	return true;
+}
+
+// removes sprite with given id from its parent's group, keeping it where it is on screen
+bool LCDMap::removeParent(char id) {
+	record(TRACE_REMOVE_PARENT, id);
+
+	short slot = getSlot(id);
+	if (slot == ERROR || transforms.parent[slot] < 0) return false;
+
+	int x, y;
+	short rotation;
+	toWorld(slot, x, y, rotation);
+	transforms.parent[slot] = -1;
+	toLocal(slot, x, y, rotation);
+	worldDirty = true;
+	return true;
+}
+
+// changes frame of sprite with given id and of all its children to their next frame
+bool LCDMap::nextFrameGroup(char id) {
+	record(TRACE_NEXT_FRAME_GROUP, id);
+
+	short slot = getSlot(id);
+	if (slot == ERROR) return false;
+
+	for (int i = 0; i < transforms.count; ++i) {
+		short ancestor = i;
+		while (ancestor >= 0 && ancestor != slot) {
+			ancestor = transforms.parent[ancestor];
+		}
+
+		if (ancestor == slot) {
+			advanceFrame(sprites.get(transforms.ids[i]));
+		}
+	}
+
+	return true;
+}
+
+// gets screen area covered by sprite with given id and all its children
+// right and bottom are one past the last pixel
+bool LCDMap::getGroupBounds(char id, int& left, int& top, int& right, int& bottom) {
+	short slot = getSlot(id);
+	if (slot == ERROR) return false;
+
+	resolve();
+	left = transforms.boxLeft[slot];
+	top = transforms.boxTop[slot];
+	right = transforms.boxRight[slot];
+	bottom = transforms.boxBottom[slot];
+	return true;
+}
+
+// adds horizontal frame to sprite with given id
+// the diagonal frame is only created once it is drawn on
 bool LCDMap::addFrame(char id, char frameId) {
+	record(TRACE_ADD_FRAME, id, frameId);
+
 	Sprite* sprite = sprites.get(id);
 	if (sprite == nullptr) return false;
 
-    return sprite->framesH.add(frameId, new Frame(sprite->size)) && sprite->framesD.add(frameId, new Frame(sprite->size));
+    short size = transforms.size[sprite->slot];
+    return sprite->framesH.add(frameId, new Frame(size));
 }
 
 // draws a pixel on the horizontal frame
 bool LCDMap::drawFrameH(char id, char frameId, short x, short y) {
+    record(TRACE_DRAW_H, id, frameId, x, y);
+
     Sprite* sprite = sprites.get(id);
     if (sprite == nullptr) return false;
 
@@ -162,10 +381,9 @@ bool LCDMap::drawFrameH(char id, char frameId, short x, short y) {
 
 // draws a pixel on the diagonal frame
 bool LCDMap::drawFrameD(char id, char frameId, short x, short y) {
-    Sprite* sprite = sprites.get(id);
-    if (sprite == nullptr) return false;
+    record(TRACE_DRAW_D, id, frameId, x, y);
 
-    Frame* frame = sprite->framesD.get(frameId);
+    Frame* frame = diagonalFrame(sprites.get(id), frameId);
     if (frame == nullptr) return false;
 
     return frame->drawPixel(x, y);
@@ -173,6 +391,8 @@ bool LCDMap::drawFrameD(char id, char frameId, short x, short y) {
 
 // erases a pixel from the horizontal frame
 bool LCDMap::eraseFrameH(char id, char frameId, short x, short y) {
+    record(TRACE_ERASE_H, id, frameId, x, y);
+
     Sprite* sprite = sprites.get(id);
     if (sprite == nullptr) return false;
 
@@ -184,23 +404,80 @@ bool LCDMap::eraseFrameH(char id, char frameId, short x, short y) {
 
 // erases a pixel from the diagonal frame
 bool LCDMap::eraseFrameD(char id, char frameId, short x, short y) {
-    Sprite* sprite = sprites.get(id);
-    if (sprite == nullptr) return false;
+    record(TRACE_ERASE_D, id, frameId, x, y);
 
-    Frame* frame = sprite->framesD.get(frameId);
+    Frame* frame = diagonalFrame(sprites.get(id), frameId);
     if (frame == nullptr) return false;
 
     return frame->clearPixel(x, y);
 }
 
-// rotates the horizontal and diagonal frame of sprite with given id
+// returns horizontal frame, or nullptr if it doesn't exist
+// lets many pixels or shapes be drawn without looking up the sprite and frame every time
+// changes made through the frame are recorded as the frame's bytes before the next recorded change
+Frame* LCDMap::getFrameH(char id, char frameId) {
+    Sprite* sprite = sprites.get(id);
+    if (sprite == nullptr) return nullptr;
+
+    return track(id, frameId, false, sprite->framesH.get(frameId));
+}
+
+// returns diagonal frame, or nullptr if the horizontal frame doesn't exist
+// a blank diagonal frame is created on first use and replaces the derived one
+// changes made through the frame are recorded as for getFrameH()
+Frame* LCDMap::getFrameD(char id, char frameId) {
+    return track(id, frameId, true, diagonalFrame(sprites.get(id), frameId));
+}
+
+// returns diagonal frame drawn by the user, creating it if the horizontal frame exists
+Frame* LCDMap::diagonalFrame(Sprite* sprite, char frameId) {
+    if (sprite == nullptr || !sprite->framesH.contains(frameId)) return nullptr;
+
+    Frame* frame = sprite->framesD.get(frameId);
+    if (frame == nullptr) {
+        frame = new Frame(transforms.size[sprite->slot]);
+        sprite->framesD.add(frameId, frame);
+    }
+
+    return frame;
+}
+
+// moves sprite with given id on to its next frame
 bool LCDMap::nextFrame(char id) {
+	record(TRACE_NEXT_FRAME, id);
+
 	Sprite* sprite = sprites.get(id);
 	if (sprite == nullptr) return false;
 
+	advanceFrame(sprite);
+	return true;
+}
+
+// moves given sprite on to its next frame, or moves its stream on
+// diagonal frames are looked up by the id of the current horizontal frame
+void LCDMap::advanceFrame(Sprite* sprite) {
+	if (sprite == nullptr) return;
+
+	if (sprite->stream != nullptr) {
+		sprite->stream->next();
+		return;
+	}
+
 	sprite->framesH.rotate();
-	sprite->framesD.rotate();
+}
+
+// plays frames of sprite with given id from given stream instead of its own frames
+// stream must have the same size as the sprite, and is not deleted with the sprite
+// nullptr switches back to the sprite's own frames
+// the stream's frames are not recorded, so a trace only marks the sprite as streamed
+bool LCDMap::attachStream(char id, FrameStream* stream) {
+	record(TRACE_ATTACH_STREAM, id, stream != nullptr);
 
+	Sprite* sprite = sprites.get(id);
+	if (sprite == nullptr) return false;
+	if (stream != nullptr && stream->size() != transforms.size[sprite->slot]) return false;
+
+	sprite->stream = stream;
 	return true;
 }
 
@@ -216,13 +493,20 @@ unsigned char* LCDMap::readCharacter(short row, short col) {
 	// get character position in pixels
     int charX = col * charWdth;
     int charY = row * charHght;
+    resolve();
+    recordHandles();
 
     // for every sprite
 	for (int i = 0; i < sprites.size(); ++i) {
 	    char id = sprites.id();
+	    short slot = sprites.get()->slot;
+
+	    // skip whole groups, then the sprite with its own children, if they don't overlap with the character
+	    bool visible = overlaps(transforms.root[slot], charX, charY, charX + charWdth, charY + charHght)
+	            && overlaps(slot, charX, charY, charX + charWdth, charY + charHght);
 
 	    // copy the pixels that overlap with the character
-	    for (int i = 0; i < charHght; ++i) {
+	    for (int i = 0; visible && i < charHght; ++i) {
 	        character[i] |= readSprite(id, charX, charY + i);
 	    }
 
@@ -238,9 +522,65 @@ unsigned char* LCDMap::readCharacter(short row, short col) {
 	return nullptr;
 }
 
+// draws all sprites into given framebuffer, replacing its previous contents
+// every rotation is read a whole sprite row at a time, up to 64 pixels per word
+void LCDMap::render(Framebuffer& framebuffer) {
+	framebuffer.clear();
+	resolve();
+	recordHandles();
+
+	for (int i = 0; i < sprites.size(); ++i) {
+		Sprite* sprite = sprites.get();
+		sprites.rotate();
+
+		// skip whole groups that are off screen
+		if (!overlaps(transforms.root[sprite->slot], 0, 0, framebuffer.width(), framebuffer.height())) continue;
+
+		bool readLine;
+		bool readDirection;
+		const Frame* frame = selectFrame(sprite, readLine, readDirection);
+		if (frame == nullptr) continue;
+
+		int spriteX = transforms.worldX[sprite->slot];
+		int spriteY = transforms.worldY[sprite->slot];
+		short spriteSize = transforms.size[sprite->slot];
+
+		// skip sprites entirely off screen
+		if (spriteX >= framebuffer.width() || spriteX + spriteSize <= 0) continue;
+		if (spriteY >= framebuffer.height() || spriteY + spriteSize <= 0) continue;
+
+		short firstRow = (spriteY < 0) ? -spriteY : 0;
+		short lastRow = framebuffer.height() - spriteY;
+		lastRow = (lastRow > spriteSize) ? spriteSize : lastRow;
+
+		for (short row = firstRow; row < lastRow; ++row) {
+			for (short col = 0; col < spriteSize; col += 64) {
+				short count = (spriteSize - col > 64) ? 64 : spriteSize - col;
+				unsigned long long bits = readRotatedRow(frame, readLine, readDirection, spriteSize, row, col, count);
+
+				if (bits != 0) {
+					framebuffer.drawRow(spriteX + col, spriteY + row, bits, count);
+				}
+			}
+		}
+	}
+}
+
+// returns count pixels of given row of the sprite as it appears on screen, starting at
+// given column; the reading line and direction are the same as for readSprite
+unsigned long long LCDMap::readRotatedRow(const Frame* frame, bool line, bool direction, short spriteSize, short row, short col, short count) const {
+	short lineNum = (line == direction) ? row : spriteSize - 1 - row;
+	short first = direction ? col : spriteSize - col - count;
+
+	unsigned long long bits = line ? frame->getRowBits(lineNum, first, count) : frame->getColBits(lineNum, first, count);
+
+	// reading backwards, so reverse the bits
+	return direction ? bits : Frame::reverseBits(bits, count);
+}
+
 // returns the row bits of a custom character at given position, as it overlaps
 // with the sprite with the given id
-unsigned char LCDMap::readSprite(char id, int posX, int posY) const {
+unsigned char LCDMap::readSprite(char id, int posX, int posY) {
 	Sprite* sprite = sprites.get(id);
 	if (sprite == nullptr) return 0;
 
@@ -252,7 +592,10 @@ unsigned char LCDMap::readSprite(char id, int posX, int posY) const {
 
 	// get the correct row or column
     unsigned char* frameLine = nullptr;
-    int lineNum = getLineNumber(readLine, readDirection, sprite->y, posY, sprite->size);
+    int spriteX = transforms.worldX[sprite->slot];
+    int spriteY = transforms.worldY[sprite->slot];
+    short spriteSize = transforms.size[sprite->slot];
+    int lineNum = getLineNumber(readLine, readDirection, spriteY, posY, spriteSize);
 	if (readLine) {
         frame->getRow(lineNum, frameLine);
 	} else {
@@ -261,10 +604,10 @@ unsigned char LCDMap::readSprite(char id, int posX, int posY) const {
     if (frameLine == nullptr) return 0;
 
 	// determine reading start index
-    int readStart = getStartPosition(readDirection, sprite->x, posX, sprite->size);
+    int readStart = getStartPosition(readDirection, spriteX, posX, spriteSize);
 
     // read 5 bits from start index, to the right or to the left
-	unsigned char result = readBytePiece(readDirection, readStart, frameLine, sprite->size);
+	unsigned char result = readBytePiece(readDirection, readStart, frameLine, spriteSize);
 
 	delete[] frameLine;
 	return result;
@@ -275,43 +618,73 @@ unsigned char LCDMap::readSprite(char id, int posX, int posY) const {
 // determines whether to read rows or columns
 // determines whether to read right or left along the row or column
 // returns true if frame was successfully selected
-Frame* LCDMap::selectFrame(char id, bool& readLine, bool& readDirection) const {
-	Sprite* sprite = sprites.get(id);
+Frame* LCDMap::selectFrame(char id, bool& readLine, bool& readDirection) {
+	return selectFrame(sprites.get(id), readLine, readDirection);
+}
+
+// selects frame and reading direction of given sprite, as above
+// a diagonal frame that was never drawn is derived from the horizontal frame
+Frame* LCDMap::selectFrame(const Sprite* sprite, bool& readLine, bool& readDirection) {
 	if (sprite == nullptr) return nullptr;
 
-	switch(sprite->rotation) {
+	short rotation = transforms.worldRotation[sprite->slot];
+	FrameStream* stream = sprite->stream;
+	Frame* frameH = nullptr;
+	Frame* frameD = nullptr;
+
+	// streamed frames take the place of the horizontal and diagonal queues
+	// a stream without diagonal frames shares one cache entry per sprite,
+	// derived again whenever the stream moves on
+	if (stream != nullptr) {
+		frameH = stream->currentH();
+		frameD = stream->currentD();
+		if (rotation % 90 != 0 && frameD == nullptr && frameH != nullptr) {
+			frameD = cache.getDiagonal(transforms.ids[sprite->slot], STREAM_FRAME, frameH);
+		}
+	} else {
+		frameH = sprite->framesH.get();
+		if (rotation % 90 != 0 && frameH != nullptr) {
+			char frameId = sprite->framesH.id();
+			frameD = sprite->framesD.get(frameId);
+			if (frameD == nullptr) {
+				frameD = cache.getDiagonal(transforms.ids[sprite->slot], frameId, frameH);
+			}
+		}
+	}
+
+	switch(rotation) {
 		case 0:
             readLine = true;
             readDirection = true;
-            return sprite->framesH.get();
+            return frameH;
 		case 45:
             readLine = true;
             readDirection = true;
-			return sprite->framesD.get();
+			return frameD;
 		case 90:
             readLine = false;
             readDirection = false;
-            return sprite->framesH.get();
+            return frameH;
 		case 135:
             readLine = false;
             readDirection = false;
-            return sprite->framesD.get();
+            return frameD;
 		case 180:
             readLine = true;
             readDirection = false;
-            return sprite->framesH.get();
+            return frameH;
 		case 225:
             readLine = true;
             readDirection = false;
-            return sprite->framesD.get();
+            return frameD;
 		case 270:
             readLine = false;
             readDirection = true;
-            return sprite->framesH.get();
+            return frameH;
 		case 315:
             readLine = false;
             readDirection = true;
-            return sprite->framesD.get();
+            return frameD;
 	}
 
 	return nullptr;
@@ -364,10 +737,10 @@ unsigned char LCDMap::readBytePiece(bool direction, int startPos, unsigned char*
 
 // returns size of sprite with given id
 short LCDMap::size(char id) const {
-    Sprite* sprite = sprites.get(id);
-    if (sprite == nullptr) return ERROR;
+    short slot = getSlot(id);
+    if (slot == ERROR) return ERROR;
 
-    return sprite->size;
+    return transforms.size[slot];
 }
 
 // returns true if sprite with given id exists, false otherwise
@@ -377,9 +750,319 @@ bool LCDMap::contains(char id) const {
 
 // returns number of frames for sprite with given id
 int LCDMap::frames(char id) const {
-    if (sprites.get(id)->framesH.size() == sprites.get(id)->framesD.size()) {
-        return sprites.get(id)->framesH.size();
-    }
+    Sprite* sprite = sprites.get(id);
+    if (sprite == nullptr) return ERROR;
+
+    return sprite->framesH.size();
+}
+
+// sets most bytes kept by derived diagonal frames
+// frames that were not drawn recently are derived again when needed
+void LCDMap::setCacheLimit(int bytes) {
+    cache.setLimit(bytes);
+}
+
+// returns transform slot of sprite with given id, or -1 if it doesn't exist
+short LCDMap::getSlot(char id) const {
+	Sprite* sprite = sprites.get(id);
+
+	return (sprite == nullptr) ? ERROR : sprite->slot;
+}
+
+// returns slot of the sprite at the top of the group of sprite with given id, or -1 if it doesn't exist
+// screen transforms and group boxes are up to date afterwards
+short LCDMap::getRootSlot(char id) const {
+	short slot = getSlot(id);
+	if (slot == ERROR) return ERROR;
+
+	resolve();
+	return transforms.root[slot];
+}
+
+// moves sprite in given slot by given amount, stopping its group at the bounds
+// sprites with a parent move relative to it and are not stopped by the bounds
+void LCDMap::moveSlot(short slot, int x, int y) {
+	// children only change their own group
+	if (transforms.parent[slot] >= 0) {
+		transforms.x[slot] += x;
+		transforms.y[slot] += y;
+		if (!worldDirty) {
+			resolveGroup(transforms.root[slot]);
+		}
+		return;
+	}
+
+	// the whole group stops at the bounds, measured by the box around it
+	resolve();
+	int shiftLeft = -leftBound - transforms.boxLeft[slot];
+	int shiftTop = -topBound - transforms.boxTop[slot];
+	int shiftRight = (charWdth + rightBound) - transforms.boxRight[slot];
+	int shiftBottom = (charHght + bottomBound) - transforms.boxBottom[slot];
+
+	x = (shiftLeft > x) ? shiftLeft : (shiftRight < x) ? shiftRight : x;
+	y = (shiftTop > y) ? shiftTop : (shiftBottom < y) ? shiftBottom : y;
+	transforms.x[slot] += x;
+	transforms.y[slot] += y;
+	translateGroup(slot, x, y);
+}
+
+// moves screen transforms and boxes of the group under the root in given slot
+// by given amount, so moving a root doesn't make the whole screen resolve again
+void LCDMap::translateGroup(short slot, int x, int y) {
+	for (short i = slot; i >= 0; i = transforms.next[i]) {
+		transforms.worldX[i] += x;
+		transforms.worldY[i] += y;
+		transforms.boxLeft[i] += x;
+		transforms.boxTop[i] += y;
+		transforms.boxRight[i] += x;
+		transforms.boxBottom[i] += y;
+	}
+}
+
+// sends every following change to given recorder, or stops recording if nullptr
+// sprites that already exist are not written, so set it before the first createSprite
+void LCDMap::setRecorder(TraceRecorder* traceRecorder) {
+	recorder = traceRecorder;
+}
+
+// passes change to the recorder, if one is set
+// frames changed through a handle are recorded first, so replay sees them in order
+void LCDMap::record(unsigned char op, int a, int b, int c, int d) {
+	if (recorder != nullptr) {
+		recordHandles();
+		recorder->record(op, a, b, c, d);
+	}
+}
+
+// remembers frame handed out by getFrameH() or getFrameD(), so changes made through it can be recorded
+// the frame is recorded right away, since a handed out diagonal frame may have just been created
+// returns the frame
+Frame* LCDMap::track(char id, char frameId, bool diagonal, Frame* frame) {
+	if (frame == nullptr) return nullptr;
+
+	for (int i = 0; i < handleCount; ++i) {
+		if (handles[i].frame == frame) return frame;
+	}
+
+	if (handleCount == handleCapacity) {
+		short newCapacity = (handleCapacity < 4) ? 4 : handleCapacity * 2;
+		FrameHandle* temp = new FrameHandle[newCapacity];
+		for (int i = 0; i < handleCount; ++i) {
+			temp[i] = handles[i];
+		}
+
+		delete[] handles;
+		handles = temp;
+		handleCapacity = newCapacity;
+	}
+
+	handles[handleCount++] = FrameHandle{ id, frameId, diagonal, frame, frame->version() };
+	if (recorder != nullptr) {
+		recorder->recordFrame(id, frameId, diagonal, frame);
+	}
+
+	return frame;
+}
+
+// records every handed out frame that changed since it was last recorded
+void LCDMap::recordHandles() {
+	if (recorder == nullptr) return;
+
+	for (int i = 0; i < handleCount; ++i) {
+		if (handles[i].frame->version() != handles[i].version) {
+			handles[i].version = handles[i].frame->version();
+			recorder->recordFrame(handles[i].id, handles[i].frameId, handles[i].diagonal, handles[i].frame);
+		}
+	}
+}
+
+// forgets frames handed out for sprite with given id, before they are deleted
+void LCDMap::untrack(char id) {
+	for (int i = handleCount - 1; i >= 0; --i) {
+		if (handles[i].id == id) {
+			handles[i] = handles[--handleCount];
+		}
+	}
+}
+
+// gets position and rotation of sprite in given slot on screen, following its parents
+// children keep their offset from the parent's center, turned with the parent
+void LCDMap::toWorld(short slot, int& x, int& y, short& rotation) const {
+	short parent = transforms.parent[slot];
+	if (parent < 0) {
+		x = transforms.x[slot];
+		y = transforms.y[slot];
+		rotation = transforms.rotation[slot];
+		return;
+	}
+
+	int parentX, parentY;
+	short parentRot;
+	toWorld(parent, parentX, parentY, parentRot);
+
+	// offset between centers, in half pixels so odd sizes stay exact
+	short parentSize = transforms.size[parent];
+	short spriteSize = transforms.size[slot];
+	long dx = 2L * transforms.x[slot] + transforms.halfX[slot] + spriteSize - parentSize;
+	long dy = 2L * transforms.y[slot] + transforms.halfY[slot] + spriteSize - parentSize;
+
+	// turn offset clockwise in 90 degree steps, then by 45 degrees if needed (181 / 256 ~ 1 / sqrt 2)
+	for (short i = 0; i < parentRot / 90; ++i) {
+		long temp = dx;
+		dx = -dy;
+		dy = temp;
+	}
+	if (parentRot % 90 != 0) {
+		long temp = dx;
+		dx = (dx - dy) * 181 / 256;
+		dy = (temp + dy) * 181 / 256;
+	}
+
+	long doubleX = 2L * parentX + parentSize + dx - spriteSize;
+	long doubleY = 2L * parentY + parentSize + dy - spriteSize;
+	x = (doubleX >= 0) ? doubleX / 2 : -((1 - doubleX) / 2);
+	y = (doubleY >= 0) ? doubleY / 2 : -((1 - doubleY) / 2);
+	rotation = (parentRot + transforms.rotation[slot]) % 360;
+}
+
+// sets position and rotation of sprite in given slot relative to its parent,
+// so that it appears on screen at the given position and rotation (the inverse of toWorld)
+void LCDMap::toLocal(short slot, int x, int y, short rotation) {
+	short parent = transforms.parent[slot];
+	transforms.halfX[slot] = 0;
+	transforms.halfY[slot] = 0;
+	if (parent < 0) {
+		transforms.x[slot] = x;
+		transforms.y[slot] = y;
+		transforms.rotation[slot] = rotation;
+		return;
+	}
+
+	int parentX, parentY;
+	short parentRot;
+	toWorld(parent, parentX, parentY, parentRot);
+	transforms.rotation[slot] = (rotation - parentRot + 360) % 360;
+
+	// offset between centers on screen, in half pixels
+	short parentSize = transforms.size[parent];
+	short spriteSize = transforms.size[slot];
+	long dx = 2L * x + spriteSize - 2L * parentX - parentSize;
+	long dy = 2L * y + spriteSize - 2L * parentY - parentSize;
+
+	// undo the 45 degree turn (128 / 181 undoes the 181 / 256 of toWorld),
+	// then turn back counter-clockwise in 90 degree steps
+	if (parentRot % 90 != 0) {
+		long temp = dx;
+		dx = (dx + dy) * 128 / 181;
+		dy = (dy - temp) * 128 / 181;
+	}
+	for (short i = 0; i < parentRot / 90; ++i) {
+		long temp = dx;
+		dx = dy;
+		dy = -temp;
+	}
+
+	// top left corner, in half pixels; exact unless the parent is diagonal
+	long startX = dx + parentSize - spriteSize;
+	long startY = dy + parentSize - spriteSize;
+	long bestX = startX;
+	long bestY = startY;
+	long bestError = -1;
+	short reach = (parentRot % 90 == 0) ? 0 : 2;
+
+	// the 45 degree turn rounds, so pick the neighbouring offset that lands closest
+	for (long doubleX = startX - reach; doubleX <= startX + reach; ++doubleX) {
+		for (long doubleY = startY - reach; doubleY <= startY + reach; ++doubleY) {
+			setOffset(slot, doubleX, doubleY);
+
+			int screenX, screenY;
+			short screenRot;
+			toWorld(slot, screenX, screenY, screenRot);
+
+			long errorX = screenX - x;
+			long errorY = screenY - y;
+			long error = ((errorX < 0) ? -errorX : errorX) + ((errorY < 0) ? -errorY : errorY);
+			if (bestError < 0 || error < bestError) {
+				bestError = error;
+				bestX = doubleX;
+				bestY = doubleY;
+			}
+		}
+	}
+
+	setOffset(slot, bestX, bestY);
+}
+
+// sets offset of sprite in given slot from its parent, given in half pixels
+void LCDMap::setOffset(short slot, long doubleX, long doubleY) {
+	transforms.x[slot] = (doubleX >= 0) ? doubleX / 2 : -((1 - doubleX) / 2);
+	transforms.y[slot] = (doubleY >= 0) ? doubleY / 2 : -((1 - doubleY) / 2);
+	transforms.halfX[slot] = doubleX - 2L * transforms.x[slot];
+	transforms.halfY[slot] = doubleY - 2L * transforms.y[slot];
+}
+
+// updates screen transforms and group bounding boxes if anything moved since the last update
+void LCDMap::resolve() const {
+	if (!worldDirty) return;
+
+	for (short i = 0; i < transforms.count; ++i) {
+		short root = i;
+		while (transforms.parent[root] >= 0) {
+			root = transforms.parent[root];
+		}
+		transforms.root[i] = root;
+		transforms.next[i] = -1;
+		place(i);
+	}
+
+	// link every child into its group's list, and grow the box of every parent to cover it
+	for (short i = 0; i < transforms.count; ++i) {
+		short root = transforms.root[i];
+		if (root != i) {
+			transforms.next[i] = transforms.next[root];
+			transforms.next[root] = i;
+		}
+		growBoxes(i);
+	}
+
+	worldDirty = false;
+}
+
+// updates screen transforms and boxes of the group under the root in given slot only
+// the rest of the screen must already be resolved
+void LCDMap::resolveGroup(short slot) const {
+	for (short i = slot; i >= 0; i = transforms.next[i]) {
+		place(i);
+	}
+
+	for (short i = slot; i >= 0; i = transforms.next[i]) {
+		growBoxes(i);
+	}
+}
+
+// sets screen transform of sprite in given slot, and its box to cover only itself
+void LCDMap::place(short slot) const {
+	toWorld(slot, transforms.worldX[slot], transforms.worldY[slot], transforms.worldRotation[slot]);
+
+	transforms.boxLeft[slot] = transforms.worldX[slot];
+	transforms.boxTop[slot] = transforms.worldY[slot];
+	transforms.boxRight[slot] = transforms.worldX[slot] + transforms.size[slot];
+	transforms.boxBottom[slot] = transforms.worldY[slot] + transforms.size[slot];
+}
+
+// grows the box of every parent of sprite in given slot, up the chain, to cover it
+void LCDMap::growBoxes(short slot) const {
+	for (short p = transforms.parent[slot]; p >= 0; p = transforms.parent[p]) {
+		transforms.boxLeft[p] = (transforms.boxLeft[slot] < transforms.boxLeft[p]) ? transforms.boxLeft[slot] : transforms.boxLeft[p];
+		transforms.boxTop[p] = (transforms.boxTop[slot] < transforms.boxTop[p]) ? transforms.boxTop[slot] : transforms.boxTop[p];
+		transforms.boxRight[p] = (transforms.boxRight[slot] > transforms.boxRight[p]) ? transforms.boxRight[slot] : transforms.boxRight[p];
+		transforms.boxBottom[p] = (transforms.boxBottom[slot] > transforms.boxBottom[p]) ? transforms.boxBottom[slot] : transforms.boxBottom[p];
+	}
+}
 
-    return ERROR;
+// returns true if bounding box of sprite in given slot (with its children) overlaps given area
+// right and bottom are one past the last pixel
+bool LCDMap::overlaps(short slot, int left, int top, int right, int bottom) const {
+	return transforms.boxLeft[slot] < right && transforms.boxRight[slot] > left
+	        && transforms.boxTop[slot] < bottom && transforms.boxBottom[slot] > top;
 }
\ No newline at end of file
@@ -2,18 +2,30 @@
 #define LCDMAP_H
 
 #include "Frame.h"
+#include "FrameCache.h"
+#include "FrameStream.h"
+#include "Framebuffer.h"
 #include "Queue.h"
+#include "Trace.h"
+#include "Transforms.h"
 
 struct Sprite {
 	~Sprite() { framesH.clear(); framesD.clear(); }
-	int x;
-	int y;
-	short rotation;
-	short size;
+	short slot;
+	FrameStream* stream;
 	Queue<Frame> framesH;
     Queue<Frame> framesD;
 };
 
+// frame handed out by getFrameH() or getFrameD(), and its version when last recorded
+struct FrameHandle {
+	char id;
+	char frameId;
+	bool diagonal;
+	const Frame* frame;
+	unsigned int version;
+};
+
 class LCDMap {
 public:
 	LCDMap(short charWidth, short charHeight);
@@ -30,22 +42,38 @@ public:
 	int getSpriteX(char id) const;
 	int getSpriteY(char id) const;
 	short getSpriteRot(char id) const;
+	int getSpriteVelocity(char id) const;
 	void shiftSprite(char id, int x, int y);
+	void shiftSpriteForward(char id, int pixels);
 	void rotateSprite(char id, short degrees);
+	void setSpriteVelocity(char id, int pixels);
+	void stepAll(int dt);
 	bool createSprite(char id, short sideLength);
 	bool removeSprite(char id);
 
+	bool setParent(char id, char parentId);
+	bool removeParent(char id);
+	bool nextFrameGroup(char id);
+	bool getGroupBounds(char id, int& left, int& top, int& right, int& bottom);
+
 	bool addFrame(char id, char frameId);
 	bool drawFrameH(char id, char frameId, short x, short y);
 	bool drawFrameD(char id, char frameId, short x, short y);
 	bool eraseFrameH(char id, char frameId, short x, short y);
     bool eraseFrameD(char id, char frameId, short x, short y);
+	Frame* getFrameH(char id, char frameId);
+	Frame* getFrameD(char id, char frameId);
 	bool nextFrame(char id);
+	bool attachStream(char id, FrameStream* stream);
 
 	unsigned char* readCharacter(short row, short col);
+	void render(Framebuffer& framebuffer);
 	short size(char id) const;
 	bool contains(char id) const;
 	int frames(char id) const;
+	void setCacheLimit(int bytes);
+
+	void setRecorder(TraceRecorder* traceRecorder);
 
 private:
 	const int ERROR = -1;
@@ -57,9 +85,36 @@ private:
 	int bottomBound;
 	int leftBound;
 	Queue<Sprite> sprites;
+	Transforms transforms;
+	FrameCache cache;
+	TraceRecorder* recorder;
+	FrameHandle* handles;
+	short handleCount;
+	short handleCapacity;
+	mutable bool worldDirty;
 
-	unsigned char readSprite(char id, int posX, int posY) const;
-	Frame* selectFrame(char id, bool& row, bool& right) const;
+	void record(unsigned char op, int a = 0, int b = 0, int c = 0, int d = 0);
+	Frame* track(char id, char frameId, bool diagonal, Frame* frame);
+	void recordHandles();
+	void untrack(char id);
+	short getSlot(char id) const;
+	short getRootSlot(char id) const;
+	void moveSlot(short slot, int x, int y);
+	void toWorld(short slot, int& x, int& y, short& rotation) const;
+	void toLocal(short slot, int x, int y, short rotation);
+	void setOffset(short slot, long doubleX, long doubleY);
+	void resolve() const;
+	void resolveGroup(short slot) const;
+	void place(short slot) const;
+	void growBoxes(short slot) const;
+	void translateGroup(short slot, int x, int y);
+	void advanceFrame(Sprite* sprite);
+	bool overlaps(short slot, int left, int top, int right, int bottom) const;
+	Frame* diagonalFrame(Sprite* sprite, char frameId);
+	unsigned char readSprite(char id, int posX, int posY);
+	Frame* selectFrame(char id, bool& row, bool& right);
+	Frame* selectFrame(const Sprite* sprite, bool& row, bool& right);
+	unsigned long long readRotatedRow(const Frame* frame, bool line, bool direction, short spriteSize, short row, short col, short count) const;
     int getLineNumber(bool line, bool direction, int spriteY, int charY, short spriteSize) const;
     int getStartPosition(bool direction, int spriteX, int charX, short spriteSize) const;
 	unsigned char readBytePiece(bool direction, int startPos, unsigned char* arr, int length) const;
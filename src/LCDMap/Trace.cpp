@@ -0,0 +1,324 @@
+// Title: Trace
+// Created by: Vlad Netrebchenko
+// Start Date: July 10, 2019
+// Last Modification: July 10, 2019
+
+// Description:
+// TraceRecorder writes every LCDMap mutation and the characters
+// drawn on every tick into a compact binary trace. Numbers are
+// stored as variable-length integers and each tick only stores the
+// characters that changed since the previous tick, as an XOR against
+// the old character. TraceReader decodes the same format so a trace
+// can be replayed and compared against the recorded characters.
+// A trace starts from an empty map, so the recorder has to be set
+// before the first sprite is created for the trace to replay.
+//
+// Format:
+// header  'L' 'C' 'D' 'T' version rows cols charWidth charHeight
+// op      op-byte followed by that op's arguments
+// frame   TRACE_FRAME_BYTES and its arguments, then the frame's bytes
+// tick    TRACE_TICK, then (cell-delta, charHeight XOR bytes) for every
+//         changed cell, terminated by a cell-delta of 0
+// end     TRACE_END
+
+#include "Trace.h"
+
+const unsigned char TRACE_VERSION = 1;
+
+// number of integer arguments stored after each op
+const unsigned char TRACE_ARGS[TRACE_OP_COUNT] = {
+	0,  // TRACE_END
+	0,  // TRACE_TICK
+	2,  // TRACE_CREATE          id, size
+	1,  // TRACE_REMOVE          id
+	2,  // TRACE_ADD_FRAME       id, frame id
+	4,  // TRACE_DRAW_H          id, frame id, x, y
+	4,  // TRACE_DRAW_D          id, frame id, x, y
+	4,  // TRACE_ERASE_H         id, frame id, x, y
+	4,  // TRACE_ERASE_D         id, frame id, x, y
+	1,  // TRACE_NEXT_FRAME      id
+	3,  // TRACE_SHIFT           id, x, y
+	2,  // TRACE_SHIFT_FORWARD   id, pixels
+	2,  // TRACE_ROTATE          id, degrees
+	2,  // TRACE_SET_VELOCITY    id, pixels
+	1,  // TRACE_STEP_ALL        dt
+	4,  // TRACE_SET_BOUNDS      top, right, bottom, left
+	0,  // TRACE_REMOVE_BOUNDS
+	2,  // TRACE_SET_PARENT      id, parent id
+	1,  // TRACE_REMOVE_PARENT   id
+	1,  // TRACE_NEXT_FRAME_GROUP id
+	2,  // TRACE_ATTACH_STREAM   id, 1 if a stream was attached or 0 if detached
+	4   // TRACE_FRAME_BYTES     id, frame id, 1 if diagonal, byte count
+};
+
+// starts a trace for a display of given size (in characters) and writes its header
+TraceRecorder::TraceRecorder(TraceSink* sink, short rows, short cols, short charWidth, short charHeight) {
+	out = sink;
+	rowCount = rows;
+	colCount = cols;
+	charHght = charHeight;
+	lastCell = -1;
+	inTick = false;
+	buffered = 0;
+
+	// every cell starts out blank
+	int glyphBytes = rows * cols * charHeight;
+	glyphs = new unsigned char[glyphBytes];
+	for (int i = 0; i < glyphBytes; ++i) {
+		glyphs[i] = 0;
+	}
+
+	writeHeader(charWidth);
+}
+
+TraceRecorder::~TraceRecorder() {
+	delete[] glyphs;
+}
+
+// records an op and its arguments, ending the current tick if one is open
+// arguments past the op's argument count are ignored
+void TraceRecorder::record(unsigned char op, int a, int b, int c, int d, int e) {
+	if (op >= TRACE_OP_COUNT) return;
+
+	if (inTick) {
+		endTick();
+	}
+
+	int args[TRACE_MAX_ARGS] = { a, b, c, d, e };
+	writeByte(op);
+	for (int i = 0; i < TRACE_ARGS[op]; ++i) {
+		writeInt(args[i]);
+	}
+
+	flush();
+}
+
+// records every byte of a frame, for changes made to it outside of LCDMap
+// ends the current tick if one is open
+void TraceRecorder::recordFrame(char id, char frameId, bool diagonal, const Frame* frame) {
+	if (frame == nullptr) return;
+
+	int length = frame->byteSize();
+	record(TRACE_FRAME_BYTES, id, frameId, diagonal, length);
+
+	unsigned char value;
+	for (int i = 0; i < length; ++i) {
+		frame->readBytes(i, &value, 1);
+		writeByte(value);
+	}
+
+	flush();
+}
+
+// records the character drawn at given row and column (nullptr if blank)
+// cells must be recorded in row-major order within a tick
+// only characters that differ from the previous tick are written
+void TraceRecorder::recordCell(short row, short col, const unsigned char* character) {
+	if (row < 0 || row >= rowCount || col < 0 || col >= colCount) return;
+
+	int cell = row * colCount + col;
+	unsigned char* glyph = glyphs + cell * charHght;
+
+	bool changed = false;
+	for (int i = 0; i < charHght; ++i) {
+		unsigned char value = (character == nullptr) ? 0 : character[i];
+		changed |= value != glyph[i];
+	}
+	if (!changed || cell <= lastCell) return;
+
+	if (!inTick) {
+		writeByte(TRACE_TICK);
+		inTick = true;
+	}
+
+	writeVarint(cell - lastCell);
+	for (int i = 0; i < charHght; ++i) {
+		unsigned char value = (character == nullptr) ? 0 : character[i];
+		writeByte(value ^ glyph[i]);
+		glyph[i] = value;
+	}
+
+	lastCell = cell;
+	flush();
+}
+
+// closes the current tick
+// ticks in which no character changed are still written, so replay keeps frame count
+void TraceRecorder::endTick() {
+	if (!inTick) {
+		writeByte(TRACE_TICK);
+	}
+
+	writeVarint(0);
+	flush();
+
+	inTick = false;
+	lastCell = -1;
+}
+
+// closes the current tick and marks the end of the trace
+void TraceRecorder::finish() {
+	if (inTick) {
+		endTick();
+	}
+
+	writeByte(TRACE_END);
+	flush();
+}
+
+// writes magic number, version and display dimensions
+void TraceRecorder::writeHeader(short charWidth) {
+	writeByte('L');
+	writeByte('C');
+	writeByte('D');
+	writeByte('T');
+	writeByte(TRACE_VERSION);
+	writeVarint(rowCount);
+	writeVarint(colCount);
+	writeVarint(charWidth);
+	writeVarint(charHght);
+	flush();
+}
+
+// appends byte to buffer, sending the buffer to the sink when full
+void TraceRecorder::writeByte(unsigned char value) {
+	if (buffered == (int) sizeof(buffer)) {
+		flush();
+	}
+
+	buffer[buffered++] = value;
+}
+
+// writes 7 bits at a time, high bit set on every byte except the last
+void TraceRecorder::writeVarint(unsigned long value) {
+	while (value >= 0x80) {
+		writeByte((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+
+	writeByte(value);
+}
+
+// writes signed integer in zigzag form so small negative numbers stay short
+void TraceRecorder::writeInt(int value) {
+	long wide = value;
+	writeVarint((wide < 0) ? ((unsigned long) -wide << 1) - 1 : (unsigned long) wide << 1);
+}
+
+// sends buffered bytes to the sink
+void TraceRecorder::flush() {
+	if (buffered > 0 && out != nullptr) {
+		out->write(buffer, buffered);
+	}
+
+	buffered = 0;
+}
+
+// reads trace from given byte array
+TraceReader::TraceReader(const unsigned char* data, long size) {
+	bytes = data;
+	length = size;
+	pos = 0;
+	charHght = 0;
+	lastCell = -1;
+	corrupt = false;
+}
+
+// reads display dimensions from header
+// returns false if data does not start with a valid header
+bool TraceReader::readHeader(short& rows, short& cols, short& charWidth, short& charHeight) {
+	if (readByte() != 'L' || readByte() != 'C' || readByte() != 'D' || readByte() != 'T') return false;
+	if (readByte() != TRACE_VERSION) return false;
+
+	rows = readVarint();
+	cols = readVarint();
+	charWidth = readVarint();
+	charHeight = readVarint();
+	charHght = charHeight;
+
+	return !corrupt;
+}
+
+// reads next op and its arguments into given array (at least TRACE_MAX_ARGS long)
+// after TRACE_TICK, call nextCell() until it returns false
+// returns false at the end of the trace or if the trace is corrupt
+bool TraceReader::next(unsigned char& op, int* args) {
+	op = readByte();
+	if (op >= TRACE_OP_COUNT) {
+		corrupt = true;
+	}
+	if (corrupt) return false;
+
+	for (int i = 0; i < TRACE_MAX_ARGS; ++i) {
+		args[i] = (i < TRACE_ARGS[op]) ? readInt() : 0;
+	}
+
+	lastCell = -1;
+	return !corrupt && op != TRACE_END;
+}
+
+// reads next changed cell of current tick and its XOR bytes (charHeight long)
+// returns false once all changed cells of the tick have been read
+bool TraceReader::nextCell(int& cell, unsigned char* delta) {
+	unsigned long step = readVarint();
+	if (corrupt || step == 0) return false;
+
+	cell = lastCell + step;
+	for (int i = 0; i < charHght; ++i) {
+		delta[i] = readByte();
+	}
+
+	lastCell = cell;
+	return !corrupt;
+}
+
+// reads bytes that follow TRACE_FRAME_BYTES into given array
+// returns false if the trace ended early
+bool TraceReader::readBytes(unsigned char* data, int length) {
+	for (int i = 0; i < length; ++i) {
+		data[i] = readByte();
+	}
+
+	return !corrupt;
+}
+
+// returns false if the trace ended early or contained an unknown op
+bool TraceReader::valid() const {
+	return !corrupt;
+}
+
+// returns number of bytes read so far
+long TraceReader::position() const {
+	return pos;
+}
+
+// returns next byte, or 0 and marks trace as corrupt if none are left
+unsigned char TraceReader::readByte() {
+	if (pos >= length) {
+		corrupt = true;
+		return 0;
+	}
+
+	return bytes[pos++];
+}
+
+// reads 7 bits at a time until a byte without the high bit
+unsigned long TraceReader::readVarint() {
+	unsigned long value = 0;
+	short shift = 0;
+	unsigned char next;
+
+	do {
+		next = readByte();
+		value |= (unsigned long) (next & 0x7F) << shift;
+		shift += 7;
+	} while ((next & 0x80) && shift < 32);
+
+	return value;
+}
+
+// reads zigzag encoded signed integer
+int TraceReader::readInt() {
+	unsigned long value = readVarint();
+	return (value & 1) ? -(long) ((value + 1) >> 1) : (long) (value >> 1);
+}
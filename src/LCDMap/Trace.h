@@ -0,0 +1,121 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdio.h>
+#endif
+
+#include "Frame.h"
+
+using namespace std;
+
+enum TraceOp {
+	TRACE_END,
+	TRACE_TICK,
+	TRACE_CREATE,
+	TRACE_REMOVE,
+	TRACE_ADD_FRAME,
+	TRACE_DRAW_H,
+	TRACE_DRAW_D,
+	TRACE_ERASE_H,
+	TRACE_ERASE_D,
+	TRACE_NEXT_FRAME,
+	TRACE_SHIFT,
+	TRACE_SHIFT_FORWARD,
+	TRACE_ROTATE,
+	TRACE_SET_VELOCITY,
+	TRACE_STEP_ALL,
+	TRACE_SET_BOUNDS,
+	TRACE_REMOVE_BOUNDS,
+	TRACE_SET_PARENT,
+	TRACE_REMOVE_PARENT,
+	TRACE_NEXT_FRAME_GROUP,
+	TRACE_ATTACH_STREAM,
+	TRACE_FRAME_BYTES,
+	TRACE_OP_COUNT
+};
+
+const short TRACE_MAX_ARGS = 5;
+
+class TraceSink {
+public:
+	virtual ~TraceSink() {}
+	virtual void write(const unsigned char* data, int length) = 0;
+};
+
+#ifdef ARDUINO
+class PrintTraceSink : public TraceSink {
+public:
+	PrintTraceSink(Print& output) : out(output) {}
+	void write(const unsigned char* data, int length) { out.write(data, length); }
+
+private:
+	Print& out;
+};
+#else
+class FileTraceSink : public TraceSink {
+public:
+	FileTraceSink(FILE* output) : out(output) {}
+	void write(const unsigned char* data, int length) { fwrite(data, 1, length, out); }
+
+private:
+	FILE* out;
+};
+#endif
+
+class TraceRecorder {
+public:
+	TraceRecorder(TraceSink* sink, short rows, short cols, short charWidth, short charHeight);
+	~TraceRecorder();
+
+	void record(unsigned char op, int a = 0, int b = 0, int c = 0, int d = 0, int e = 0);
+	void recordFrame(char id, char frameId, bool diagonal, const Frame* frame);
+	void recordCell(short row, short col, const unsigned char* character);
+	void endTick();
+	void finish();
+
+private:
+	TraceSink* out;
+	short rowCount;
+	short colCount;
+	short charHght;
+	unsigned char* glyphs;
+	int lastCell;
+	bool inTick;
+	unsigned char buffer[TRACE_MAX_ARGS * 5 + 1];
+	int buffered;
+
+	void writeHeader(short charWidth);
+	void writeByte(unsigned char value);
+	void writeVarint(unsigned long value);
+	void writeInt(int value);
+	void flush();
+};
+
+class TraceReader {
+public:
+	TraceReader(const unsigned char* data, long length);
+
+	bool readHeader(short& rows, short& cols, short& charWidth, short& charHeight);
+	bool next(unsigned char& op, int* args);
+	bool nextCell(int& cell, unsigned char* delta);
+	bool readBytes(unsigned char* data, int length);
+	bool valid() const;
+	long position() const;
+
+private:
+	const unsigned char* bytes;
+	long length;
+	long pos;
+	short charHght;
+	int lastCell;
+	bool corrupt;
+
+	unsigned char readByte();
+	unsigned long readVarint();
+	int readInt();
+};
+
+#endif
@@ -0,0 +1,159 @@
+// Title: Transforms
+// Created by: Vlad Netrebchenko
+// Start Date: July 9, 2019
+// Last Modification: July 9, 2019
+
+// Description:
+// Transforms stores the position, rotation, size and velocity
+// of every sprite in parallel arrays, one slot per sprite.
+// Keeping them contiguous lets LCDMap move all sprites in a
+// single pass instead of looking each one up by id. Sprites
+// in a group store their position and rotation relative to
+// their parent, and LCDMap resolves them into screen
+// transforms and group bounding boxes before drawing. A
+// child's offset can include an extra half pixel, so that it
+// can be attached to a diagonal parent without moving.
+
+#include "Transforms.h"
+
+const short MIN_CAPACITY = 4;
+
+// copies the first count elements of arr into a new array of given capacity
+template <class T>
+static void resize(T*& arr, short count, short capacity) {
+	T* temp = new T[capacity];
+	for (int i = 0; i < count; ++i) {
+		temp[i] = arr[i];
+	}
+
+	delete[] arr;
+	arr = temp;
+}
+
+Transforms::Transforms() {
+	count = 0;
+	capacity = 0;
+	ids = nullptr;
+	x = nullptr;
+	y = nullptr;
+	rotation = nullptr;
+	size = nullptr;
+	velocity = nullptr;
+	parent = nullptr;
+	halfX = nullptr;
+	halfY = nullptr;
+	root = nullptr;
+	next = nullptr;
+	worldX = nullptr;
+	worldY = nullptr;
+	worldRotation = nullptr;
+	boxLeft = nullptr;
+	boxTop = nullptr;
+	boxRight = nullptr;
+	boxBottom = nullptr;
+}
+
+Transforms::~Transforms() {
+	delete[] ids;
+	delete[] x;
+	delete[] y;
+	delete[] rotation;
+	delete[] size;
+	delete[] velocity;
+	delete[] parent;
+	delete[] halfX;
+	delete[] halfY;
+	delete[] root;
+	delete[] next;
+	delete[] worldX;
+	delete[] worldY;
+	delete[] worldRotation;
+	delete[] boxLeft;
+	delete[] boxTop;
+	delete[] boxRight;
+	delete[] boxBottom;
+}
+
+// adds sprite with given id at position (0, 0), facing up, standing still and without parent
+// returns slot of the new sprite
+short Transforms::add(char id, short sideLength) {
+	if (count == capacity) {
+		reserve((capacity < MIN_CAPACITY) ? MIN_CAPACITY : capacity * 2);
+	}
+
+	ids[count] = id;
+	x[count] = 0;
+	y[count] = 0;
+	rotation[count] = 0;
+	size[count] = sideLength;
+	velocity[count] = 0;
+	parent[count] = -1;
+	halfX[count] = 0;
+	halfY[count] = 0;
+	root[count] = count;
+	next[count] = -1;
+	worldX[count] = 0;
+	worldY[count] = 0;
+	worldRotation[count] = 0;
+	boxLeft[count] = 0;
+	boxTop[count] = 0;
+	boxRight[count] = sideLength;
+	boxBottom[count] = sideLength;
+
+	return count++;
+}
+
+// removes sprite at given slot by moving the last sprite into it
+// children of the removed sprite must be detached first
+// returns true if another sprite was moved into the slot
+bool Transforms::remove(short slot) {
+	if (slot < 0 || slot >= count) return false;
+
+	count--;
+	if (slot == count) return false;
+
+	// children of the last sprite follow it to its new slot
+	for (int i = 0; i < count; ++i) {
+		parent[i] = (parent[i] == count) ? slot : parent[i];
+	}
+
+	ids[slot] = ids[count];
+	x[slot] = x[count];
+	y[slot] = y[count];
+	rotation[slot] = rotation[count];
+	size[slot] = size[count];
+	velocity[slot] = velocity[count];
+	parent[slot] = parent[count];
+	halfX[slot] = halfX[count];
+	halfY[slot] = halfY[count];
+
+	return true;
+}
+
+// removes all sprites, keeping the allocated arrays
+void Transforms::clear() {
+	count = 0;
+}
+
+// grows every array to the given capacity, preserving existing slots
+void Transforms::reserve(short newCapacity) {
+	resize(ids, count, newCapacity);
+	resize(x, count, newCapacity);
+	resize(y, count, newCapacity);
+	resize(rotation, count, newCapacity);
+	resize(size, count, newCapacity);
+	resize(velocity, count, newCapacity);
+	resize(parent, count, newCapacity);
+	resize(halfX, count, newCapacity);
+	resize(halfY, count, newCapacity);
+	resize(root, count, newCapacity);
+	resize(next, count, newCapacity);
+	resize(worldX, count, newCapacity);
+	resize(worldY, count, newCapacity);
+	resize(worldRotation, count, newCapacity);
+	resize(boxLeft, count, newCapacity);
+	resize(boxTop, count, newCapacity);
+	resize(boxRight, count, newCapacity);
+	resize(boxBottom, count, newCapacity);
+	capacity = newCapacity;
+}
@@ -0,0 +1,44 @@
+#ifndef TRANSFORMS_H
+#define TRANSFORMS_H
+
+using namespace std;
+
+struct Transforms {
+	Transforms();
+	~Transforms();
+
+	short add(char id, short sideLength);
+	bool remove(short slot);
+	void clear();
+
+	short count;
+	short capacity;
+	char* ids;
+	int* x;
+	int* y;
+	short* rotation;
+	short* size;
+	int* velocity;
+	short* parent;
+
+	// extra half pixel of a child's offset from its parent (0 or 1)
+	char* halfX;
+	char* halfY;
+
+	// resolved screen transforms and bounding box of each sprite with its children,
+	// and the next sprite in the same group, starting from the root (-1 after the last)
+	short* root;
+	short* next;
+	int* worldX;
+	int* worldY;
+	short* worldRotation;
+	int* boxLeft;
+	int* boxTop;
+	int* boxRight;
+	int* boxBottom;
+
+private:
+	void reserve(short newCapacity);
+};
+
+#endif